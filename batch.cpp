@@ -0,0 +1,210 @@
+#include "batch.h"
+#include "search.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <functional>
+using namespace std;
+
+/* how deep iterative deepening may go when only a node or time budget is set */
+const int MAX_DEPTH = 64;
+/* positions in flight per worker, between the reader and the output */
+const size_t BATCH_WINDOW = 16;
+
+bool result_token(const string &token) {
+    static const string RESULTS[] = {"R-0", "0-R", "F-0", "0-F", "1-0", "0-1", "1/2-1/2", "0-0"};
+    return find(begin(RESULTS), end(RESULTS), token) != end(RESULTS);
+}
+
+/* one unit of the input: a position, or why the input there could not be read */
+struct BatchItem {
+    string tps;
+    string error;
+    string input;
+};
+
+void read_positions(istream &in, const function<void(BatchItem &&)> &emit) {
+    /* TPS lines are taken as they are, PTN games are replayed ply by ply;
+       a ply that cannot be replayed still yields an item, so ids keep
+       following the input */
+    Board board;
+    bool white = true, in_moves = false;
+    string broken;
+    int move_number = 1, opening = 2;
+    string line;
+    while(getline(in, line)) {
+        istringstream tokens(line);
+        string first;
+        if(not (tokens >> first)) continue;
+        if(first[0] == '[') {
+            if(in_moves) {
+                board = Board();
+                white = true, in_moves = false, broken.clear();
+                move_number = 1, opening = 2;
+            }
+            const size_t open = line.find('"'), close = line.rfind('"');
+            const string value = (open < close) ? line.substr(open + 1, close - open - 1) : "";
+            if(first == "[Size" and value != to_string(N) and broken.empty()) broken = "unsupported board size";
+            else if(first == "[TPS") {
+                if(not board.load_tps(value, white) and broken.empty()) broken = "not a TPS position";
+                istringstream fields(value);
+                string rows, side;
+                fields >> rows >> side >> move_number;
+                opening = 0;
+            }
+            continue;
+        }
+        if(count(first.begin(), first.end(), '/') == N - 1) {
+            /* a TPS line stands alone, and ends any game before it */
+            if(in_moves) {
+                board = Board();
+                white = true, in_moves = false, broken.clear();
+                move_number = 1, opening = 2;
+            }
+            emit(BatchItem{line, "", line});
+            continue;
+        }
+        in_moves = true;
+        string text = line;
+        for(size_t open; (open = text.find('{')) != string::npos; )
+            text.erase(open, text.find('}', open) == string::npos ? string::npos : text.find('}', open) - open + 1);
+        istringstream moves(text);
+        for(string token; moves >> token; ) {
+            if(token.back() == '.' or result_token(token)) continue;
+            if(not broken.empty()) {
+                emit(BatchItem{"", broken, token});
+                continue;
+            }
+            const Move move = ptn_to_move(token);
+            /* the first two plies place the opponent's stone */
+            const bool stone = (opening > 0) ? not white : white;
+            if(not board.playable(move, stone)) {
+                emit(BatchItem{"", "illegal move", token});
+                broken = "follows an illegal move";
+                continue;
+            }
+            board.perform_move(move, stone);
+            if(opening > 0) --opening;
+            if(not white) ++move_number;
+            white = not white;
+            emit(BatchItem{board.to_tps(white, move_number), "", token});
+        }
+    }
+}
+
+string json_string(const string &text) {
+    string quoted = "\"";
+    for(const char c : text) {
+        if(c == '"' or c == '\\') quoted += '\\';
+        if((unsigned char)c >= 0x20) quoted += c;
+    }
+    return quoted + "\"";
+}
+
+string analyse(Board &board, const string &tps, const BatchOptions &options, const size_t id) {
+    ostringstream out;
+    out << "{\"id\":" << id << ",\"tps\":" << json_string(tps);
+    bool white;
+    if(not board.load_tps(tps, white)) {
+        out << ",\"error\":\"not a TPS position\"}";
+        return out.str();
+    }
+    /* nothing carries over from the positions this worker analysed before,
+       so a result does not depend on which worker it got */
+    clear_tables();
+    start_budget(options.nodes, options.millis);
+    const int max_depth = (options.depth > 0) ? options.depth : MAX_DEPTH;
+    pair<Move, int> best = make_pair("", 0);
+    int depth = 0;
+    long long nodes = 0;
+    for(int d = 1; d <= max_depth; ++d) {
+        const auto result = alpha_beta_search(board, d, white);
+        nodes += search_stats.nodes + search_stats.endgame_nodes;
+        /* a cut short iteration only counts when nothing else finished */
+        if(search_budget.stopped and depth > 0) break;
+        best = result, depth = d;
+        if(search_budget.stopped or result.second == INT_MAX or result.second == INT_MIN) break;
+    }
+    /* the line the last finished iteration left in the tables, read by keep_pv */
+    Moves pv = search_memory.pv;
+    if(pv.empty() or pv[0] != best.first) pv.assign(best.first.empty() ? 0 : 1, best.first);
+    out << ",\"best\":";
+    if(best.first.empty()) out << "null";
+    else out << "\"" << best.first << "\"";
+    out << ",\"score\":" << best.second << ",\"depth\":" << depth << ",\"nodes\":" << nodes << ",\"pv\":[";
+    for(int i = 0; i < (int)pv.size(); ++i) out << (i ? ",\"" : "\"") << pv[i] << "\"";
+    out << "]}";
+    return out.str();
+}
+
+int run_batch(const string &path, const BatchOptions &options) {
+    ifstream file;
+    if(path != "-") {
+        file.open(path);
+        if(not file) {
+            cerr << "cannot open " << path << "\n";
+            return 1;
+        }
+    }
+    istream &in = (path == "-") ? cin : file;
+    const int threads = (options.threads > 0) ? options.threads : max(1, (int)thread::hardware_concurrency());
+    /* items read but not written yet, so a slow position cannot make the
+       reader run arbitrarily far ahead of the output */
+    const size_t window = BATCH_WINDOW * threads;
+
+    mutex lock;
+    condition_variable changed;
+    deque<pair<size_t, BatchItem> > queue;
+    map<size_t, string> results;
+    size_t read = 0, written = 0;
+    bool closing = false;
+
+    vector<thread> workers;
+    for(int t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+            /* each worker reuses its own board and tables for all its positions */
+            limit_tables(options.table_entries);
+            Board board;
+            unique_lock<mutex> guard(lock);
+            while(true) {
+                changed.wait(guard, [&]() { return not queue.empty() or closing; });
+                if(queue.empty()) return;
+                const size_t id = queue.front().first;
+                const BatchItem item = move(queue.front().second);
+                queue.pop_front();
+                guard.unlock();
+                string result;
+                if(item.error.empty()) result = analyse(board, item.tps, options, id);
+                else result = "{\"id\":" + to_string(id) + ",\"input\":" + json_string(item.input)
+                              + ",\"error\":" + json_string(item.error) + "}";
+                guard.lock();
+                results[id] = move(result);
+                /* whoever completes the oldest result writes out all that follow it */
+                for(auto next = results.begin(); next != results.end() and next->first == written; next = results.erase(next)) {
+                    cout << next->second << "\n";
+                    ++written;
+                }
+                cout << flush;
+                changed.notify_all();
+            }
+        });
+    }
+    read_positions(in, [&](BatchItem &&item) {
+        unique_lock<mutex> guard(lock);
+        changed.wait(guard, [&]() { return read - written < window; });
+        queue.push_back(make_pair(read++, move(item)));
+        changed.notify_all();
+    });
+    {
+        lock_guard<mutex> guard(lock);
+        closing = true;
+    }
+    changed.notify_all();
+    for(auto &worker : workers) worker.join();
+    return 0;
+}
@@ -0,0 +1,27 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+using namespace std;
+
+struct BatchOptions {
+    int threads = 0;          /* 0 for one per core */
+    int depth = 0;            /* 0 for as deep as the budget allows */
+    long long nodes = 0;      /* node budget per position, 0 for none */
+    int millis = 0;           /* time budget per position, 0 for none */
+    size_t table_entries = (size_t)1e6;  /* table cap of each worker */
+};
+
+/*
+ * Analyses every position of a TPS or PTN stream (`path`, or stdin for "-")
+ * and writes one JSON line per position, in input order:
+ *   {"id":0,"tps":"...","best":"Fa1","score":12,"depth":5,"nodes":812,"pv":["Fa1","Fe5"]}
+ * TPS lines are one position each; a PTN game yields the position after
+ * each of its plies. Moves are written in our own notation. Positions are
+ * handed to the workers as they are read, so results follow a pipe as it
+ * goes. Input that cannot be read still takes an id and gets a line:
+ *   {"id":1,"input":"bogus","error":"illegal move"}
+ */
+int run_batch(const string &path, const BatchOptions &options);
+
+#endif
@@ -0,0 +1,173 @@
+#include "search.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdlib>
+using namespace std;
+
+/*
+ * Searches a fixed set of positions to a fixed depth and times the hot board
+ * routines. Every line of output is a JSON object; the last one carries the
+ * node signature, which only changes when the search itself does.
+ *   bench [--depth D] [--table E] [--baseline FILE]
+ * `--table E` reserves room for E positions per table up front, as the game
+ * loop does, to see how probes fare once the tables outgrow the caches.
+ * With a baseline (an earlier output) it compares signatures and speed, and
+ * exits with 1 when the signature differs.
+ */
+
+struct BenchPosition {
+    const char *name;
+    const char *tps;
+};
+
+/* only 5x5 exists in this engine, so every position is 5x5 */
+const BenchPosition POSITIONS[] = {
+    {"opening-empty", "x5/x5/x5/x5/x5 1 1"},
+    {"opening-caps", "x5/x4,2/x3,1,1/x4,1C/2,2C,2,x,1 1 5"},
+    {"midgame-walls", "x4,1/x3,2,1S/x3,2S,121/x3,1,1C/2,2C,2,2S,1 1 9"},
+    {"midgame-stacks", "x3,1S,1/x3,2,1S/121,1,12S,2S,1211C/x3,12S,2S/2,2C,2,2,1 1 17"},
+    {"endgame-tall", "2S,21S,1S,1S,1/12C,2,12,2,1S/22212S,1S,12S,2S,1211C/x2,2,12S,2S/x2,221,x,1S 1 29"},
+    {"endgame-fill", "1S,2,1S,1S,1/x,2,2,2,1S/121,1,12S,2S,1211C/x2,2,12S,2S/2,2C,2,21,1S 1 21"},
+    {"endgame-race", "1,2,1,2,1/2,1,2,1,2/1,2,1,2,x/2,1,2,1,2/1,2,1,x,x 1 12"},
+};
+const int BENCH_DEPTH = 4;
+/* board routine calls timed per position */
+const int MICRO_REPEATS = 20000;
+
+double millis_since(const chrono::steady_clock::time_point &start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+long long baseline_value(const string &path, const string &key, double &nps) {
+    /* reads the signature and speed from the last line of an earlier run */
+    ifstream file(path);
+    string line, last;
+    while(getline(file, line)) if(line.find("\"signature\"") != string::npos) last = line;
+    const size_t at = last.find("\"" + key + "\":");
+    const size_t speed = last.find("\"nps\":");
+    if(at == string::npos or speed == string::npos) return -1;
+    nps = atof(last.c_str() + speed + 6);
+    return atoll(last.c_str() + at + key.size() + 3);
+}
+
+template<typename F>
+void time_routine(const string &name, F body) {
+    /* runs `body` over every bench position and reports the time per call */
+    long long calls = 0;
+    double total = 0;
+    for(const auto &position : POSITIONS) {
+        Board board;
+        bool white;
+        board.load_tps(position.tps, white);
+        const auto start = chrono::steady_clock::now();
+        for(int i = 0; i < MICRO_REPEATS; ++i) calls += body(board, white);
+        total += millis_since(start);
+    }
+    cout << "{\"bench\":\"micro\",\"name\":\"" << name << "\",\"calls\":" << calls
+         << ",\"ns_per_call\":" << (calls ? total * 1e6 / calls : 0) << "}\n";
+}
+
+int main(int argc, char *argv[]) {
+    int depth = BENCH_DEPTH;
+    string baseline;
+    for(int i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+        if(arg == "--depth" and i + 1 < argc) depth = atoi(argv[++i]);
+        else if(arg == "--baseline" and i + 1 < argc) baseline = argv[++i];
+        else if(arg == "--table" and i + 1 < argc) {
+            const size_t entries = strtoull(argv[++i], NULL, 10);
+            max_table.reserve(entries);
+            min_table.reserve(entries);
+        }
+    }
+
+    long long signature = 0;
+    double total_ms = 0;
+    for(const auto &position : POSITIONS) {
+        Board board;
+        bool white;
+        if(not board.load_tps(position.tps, white)) {
+            cerr << "bad bench position " << position.name << "\n";
+            return 1;
+        }
+        /* each position starts from empty tables so the node count is stable */
+        clear_tables();
+        long long nodes = 0, probes = 0, hits = 0, samples = 0, probe_ns = 0, allocations = 0, endgame_nodes = 0;
+        pair<Move, int> result;
+        ostringstream time_to_depth;
+        const auto start = chrono::steady_clock::now();
+        for(int d = 1; d <= depth; ++d) {
+            result = alpha_beta_search(board, d, white);
+            nodes += search_stats.nodes;
+            probes += search_stats.tt_probes;
+            hits += search_stats.tt_hits;
+            samples += search_stats.tt_probe_samples;
+            probe_ns += search_stats.tt_probe_ns;
+            allocations += search_stats.allocations;
+            endgame_nodes += search_stats.endgame_nodes;
+            time_to_depth << (d > 1 ? "," : "") << millis_since(start);
+        }
+        const double ms = millis_since(start);
+        signature += nodes + endgame_nodes;
+        total_ms += ms;
+        cout << "{\"bench\":\"search\",\"name\":\"" << position.name << "\",\"depth\":" << depth
+             << ",\"best\":\"" << result.first << "\",\"score\":" << result.second
+             << ",\"nodes\":" << nodes << ",\"endgame_nodes\":" << endgame_nodes << ",\"ms\":" << ms
+             << ",\"nps\":" << (long long)(nodes / max(ms, 1e-3) * 1000)
+             << ",\"tt_hit_rate\":" << (probes ? (double)hits / probes : 0)
+             << ",\"tt_probe_ns\":" << (samples ? (double)probe_ns / samples : 0)
+             << ",\"allocations\":" << allocations
+             << ",\"time_to_depth_ms\":[" << time_to_depth.str() << "]}\n" << flush;
+    }
+
+    /* the search calls these right after a move, with the road maps stale */
+    time_routine("evaluate", [](Board &board, bool white) {
+        board.forget_roads();
+        volatile int score = board.evaluate(white);
+        return 1;
+    });
+    time_routine("player_road_win", [](Board &board, bool white) {
+        board.forget_roads();
+        volatile bool win = board.player_road_win(white);
+        return 1;
+    });
+    Moves moves;
+    time_routine("generate_moves", [&moves](Board &board, bool white) {
+        moves.clear();
+        generate_moves(board, moves, white);
+        return 1;
+    });
+    time_routine("make_unmake", [&moves](Board &board, bool white) {
+        moves.clear();
+        generate_moves(board, moves, white);
+        for(const auto &move : moves) {
+            const bool did_crush = board.perform_move(move, white);
+            board.undo_move(move, white, did_crush);
+        }
+        return (int)moves.size();
+    });
+
+    const long long nps = (long long)(signature / max(total_ms, 1e-3) * 1000);
+    cout << "{\"bench\":\"total\",\"depth\":" << depth << ",\"signature\":" << signature
+         << ",\"ms\":" << total_ms << ",\"nps\":" << nps
+         << ",\"table_pages\":\"" << pages_name(table_arena.pages) << "\""
+         << ",\"table_mb\":" << (table_arena.mapped_bytes >> 20) << "}\n" << flush;
+
+    if(baseline.empty()) return 0;
+    double baseline_nps = 0;
+    const long long baseline_signature = baseline_value(baseline, "signature", baseline_nps);
+    if(baseline_signature < 0) {
+        cerr << "no signature in " << baseline << "\n";
+        return 1;
+    }
+    cerr << "nps " << nps << " vs " << (long long)baseline_nps << " ("
+         << (baseline_nps > 0 ? 100.0 * (nps - baseline_nps) / baseline_nps : 0) << "%)\n";
+    if(baseline_signature != signature) {
+        cerr << "signature " << signature << " differs from baseline " << baseline_signature << "\n";
+        return 1;
+    }
+    cerr << "signature matches baseline\n";
+    return 0;
+}
@@ -1,6 +1,8 @@
 #include "board.h"
 #include <cassert>
 #include <iostream>
+#include <sstream>
+#include <cctype>
 using namespace std;
 
 int Board::evaluate_captives(const bool player_color) const {
@@ -68,40 +70,123 @@ int Board::evaluate_central_control(const bool player_color) const {
     return score;
 }
 
-bool visit[N][N];
-int Board::evaluate_components(const bool player_color) const {
-    memset(visit, false, sizeof(visit));
+/* rows and columns of the board as bitboards */
+struct Lines {
+    Bitboard column[N], row[N], all;
+    Lines() {
+        all = 0;
+        for(int i = 0; i < N; ++i) column[i] = row[i] = 0;
+        for(int x = 0; x < N; ++x) {
+            for(int y = 0; y < N; ++y) {
+                column[x] |= square_bit(x, y);
+                row[y] |= square_bit(x, y);
+                all |= square_bit(x, y);
+            }
+        }
+    }
+};
+const Lines LINES;
+
+Bitboard neighbours(const Bitboard squares) {
+    /* a step along y must not wrap into the next column */
+    return ((squares << N) | (squares >> N)
+          | ((squares << 1) & ~LINES.row[0]) | ((squares >> 1) & ~LINES.row[N-1])) & LINES.all;
+}
+
+Bitboard flood(Bitboard group, const Bitboard within) {
+    for(Bitboard grown; (grown = (group | neighbours(group)) & within) != group; ) group = grown;
+    return group;
+}
+
+bool has_road(const Bitboard road) {
+    return (flood(road & LINES.column[0], road) & LINES.column[N-1])
+        or (flood(road & LINES.row[0], road) & LINES.row[N-1]);
+}
+
+void Board::build_roads(const bool player_color, RoadMap &roads) const {
     const int WEIGHTS[] = {0, 400, 4000, 40000, 400000};
-    // const int SMALL_WEIGHT = 50;
-    int score = 0;
+    Bitboard own = 0, road = 0, empties = 0;
     for(int x = 0; x < N; ++x) {
         for(int y = 0; y < N; ++y) {
-            if((not visit[x][y]) and (not empty(x, y)) and (white(x, y) == player_color)) {
-                LRUD lrud = {x, x, y, y};
-                dfs(x, y, lrud, player_color);
-                score += (WEIGHTS[lrud.r - lrud.l] + WEIGHTS[lrud.u - lrud.d]);
+            if(board[x][y].empty()) {
+                empties |= square_bit(x, y);
+                continue;
             }
+            const Stones top = board[x][y].back();
+            if((top >= WHITE_FLAT) != player_color) continue;
+            own |= square_bit(x, y);
+            if(top != WHITE_WALL and top != BLACK_WALL) road |= square_bit(x, y);
         }
     }
-    return score;
+    roads = RoadMap();
+    roads.road = road;
+    /* every group of the player's stones scores the span of its bounding box */
+    for(Bitboard rest = own; rest; ) {
+        const Bitboard group = flood(rest & -rest, own);
+        rest &= ~group;
+        int l = N, r = -1, d = N, u = -1;
+        for(int i = 0; i < N; ++i) {
+            if(group & LINES.column[i]) l = min(l, i), r = max(r, i);
+            if(group & LINES.row[i]) d = min(d, i), u = max(u, i);
+        }
+        roads.span_score += (WEIGHTS[r - l] + WEIGHTS[u - d]);
+    }
+    const int stones_left = player_color ? (white_flats_rem + white_caps_rem)
+                                         : (black_flats_rem + black_caps_rem);
+    if(stones_left == 0) return;
+    /* the squares next to road groups touching each edge, counting the edge itself */
+    Bitboard west = LINES.column[0], east = LINES.column[N-1];
+    Bitboard south = LINES.row[0], north = LINES.row[N-1];
+    for(Bitboard rest = road; rest; ) {
+        const Bitboard group = flood(rest & -rest, road);
+        rest &= ~group;
+        const Bitboard around = neighbours(group);
+        if(group & LINES.column[0]) west |= around;
+        if(group & LINES.column[N-1]) east |= around;
+        if(group & LINES.row[0]) south |= around;
+        if(group & LINES.row[N-1]) north |= around;
+    }
+    /* placing on a square joins every group around it into one */
+    roads.threats = empties & ((west & east) | (south & north));
+}
+
+const RoadMap &Board::road_map(const bool player_color) const {
+    if(not roads_valid) {
+        build_roads(true, road_maps[1]);
+        build_roads(false, road_maps[0]);
+        roads_valid = true;
+    }
+    return road_maps[player_color];
+}
+
+int Board::evaluate_threats(const bool player_color) const {
+    const int THREAT = 20000;
+    return THREAT * __builtin_popcount(road_threats(player_color));
+}
+
+int Board::evaluate_components(const bool player_color) const {
+    return road_map(player_color).span_score;
 }
 
 int Board::evaluate_helper(const bool player_color) const {
     return evaluate_captives(player_color)
            + evaluate_tops(player_color)
            + evaluate_components(player_color)
-           + evaluate_central_control(player_color);
+           + evaluate_central_control(player_color)
+           + evaluate_threats(player_color);
 }
 
 int Board::evaluate(const bool player_color) const {
     return evaluate_helper(player_color) - evaluate_helper(not player_color);
 }
 
-bool Board::perform_placement(Move move, bool white) {
+bool Board::perform_placement(const Move &move, bool white) {
     const pair<int, int> xy = make_xy(move[1], move[2]);
     const int x = xy.first;
     const int y = xy.second;
     // cout << "x = " << x << " y = " << y << "\n";
+    --empty_squares;
+    if(move[0] == 'F') ++flat_tops[white];
     if(white) {
         switch(move[0]) {
             case 'F': board[x][y].push_back(WHITE_FLAT); white_flats_rem--; break;
@@ -120,9 +205,20 @@ bool Board::perform_placement(Move move, bool white) {
     return false; // because you cannot crush in a placement
 }
 
-bool Board::perform_motion(Move move, bool white) {
+void Board::count_motion_tops(const Move &move, const int sign) {
+    const pair<int, int> xy = make_xy(move[1], move[2]);
+    int x = xy.first, y = xy.second;
+    count_flat_top(x, y, sign);
+    for(int i = 4; i < (int)move.length(); ++i) {
+        x = next_x(x, move[3]), y = next_y(y, move[3]);
+        count_flat_top(x, y, sign);
+    }
+}
+
+bool Board::perform_motion(const Move &move, bool white) {
     // Assumes a valid move
     /* returns if you crushed or not */
+    count_motion_tops(move, -1);
     int h = move[0] - '0';
     bool crush = false;
     const pair<int, int> xy = make_xy(move[1], move[2]);
@@ -134,23 +230,24 @@ bool Board::perform_motion(Move move, bool white) {
 
     const char dir = move[3];
     // cout << "x = " << x << " y = " << y << "\n";
-    vector<Stones> pickup;
-    vector<int> drops;
+    /* the carry limit bounds both, so they live on the stack */
+    Stones pickup[N];
+    int picked = 0;
     assert((int)board[x][y].size() >= h);
-    for(int i = 4; i < (int)move.length(); ++i)
-        drops.push_back(move[i] - '0');
+    assert(h <= N);
     for(int i = 0; i < h; ++i) {
-        Stones stone = board[x][y].back();
+        pickup[picked++] = board[x][y].back();
         board[x][y].pop_back();
-        pickup.push_back(stone);
     }
-    for(int i = 0; i < (int)drops.size(); ++i) {
+    empty_squares += board[x][y].empty();
+    for(int i = 4; i < (int)move.length(); ++i) {
+        const int drop = move[i] - '0';
         x = next_x(x, dir);
         y = next_y(y, dir);
         assert(not out_of_bounds(x, y));
-        for(int j = 0; j < drops[i]; ++j) {
-            Stones stone = pickup.back();
-            pickup.pop_back();
+        for(int j = 0; j < drop; ++j) {
+            Stones stone = pickup[--picked];
+            empty_squares -= board[x][y].empty();
             if(board[x][y].empty() == false) {
                 if(board[x][y].back() == WHITE_WALL or board[x][y].back() == BLACK_WALL) {
                     crush = true;
@@ -163,15 +260,17 @@ bool Board::perform_motion(Move move, bool white) {
             board[x][y].push_back(stone);
         }
     }
+    count_motion_tops(move, +1);
     return crush;
 }
 
-void Board::undo_placement(const Move move, const bool player_color) {
+void Board::undo_placement(const Move &move, const bool player_color) {
     const pair<int, int> xy = make_xy(move[1], move[2]);
     const int x = xy.first;
     const int y = xy.second;
     assert(board[x][y].size() == 1);
     assert(this->white(x, y) == player_color);
+    count_flat_top(x, y, -1);
     switch (board[x][y].back()) {
       case WHITE_FLAT :
       case WHITE_WALL : ++white_flats_rem; break;
@@ -182,9 +281,10 @@ void Board::undo_placement(const Move move, const bool player_color) {
       default: assert(false);
     }
     board[x][y].pop_back();
+    ++empty_squares;
 }
 
-void Board::undo_motion(Move move, bool white, bool uncrush) {
+void Board::undo_motion(const Move &move, bool white, bool uncrush) {
     /*  read the height of the stack */
     const char dir = (move[3]);
     /* read the final coordinates */
@@ -193,24 +293,17 @@ void Board::undo_motion(Move move, bool white, bool uncrush) {
     const int y0 = xy.second;
     int x = xy.first;
     int y = xy.second;
-    vector<Stones> temp;
-    vector<int> drops;
+    count_motion_tops(move, -1);
+    empty_squares -= board[x0][y0].empty();
     for(int i = 4; i < (int)move.length(); ++i) {
-        drops.push_back(move[i] - '0');
-    }
-    for(int i = 0; i < (int)drops.size(); ++i) {
+        const int drop = move[i] - '0';
         x = next_x(x, dir), y = next_y(y, dir);
-        for(int j = 0; j < drops[i]; ++j) {
-            Stones stone = board[x][y].back();
-            board[x][y].pop_back();
-            temp.push_back(stone);
-        }
-        assert(drops[i] == (int)temp.size());
-        for(int j = 0; j < drops[i]; ++j) {
-            Stones stone = temp.back();
-            temp.pop_back();
-            board[x0][y0].push_back(stone);
-        }
+        /* the dropped stones go back on the source in their original order */
+        vector<Stones> &from = board[x][y];
+        assert((int)from.size() >= drop);
+        board[x0][y0].insert(board[x0][y0].end(), from.end() - drop, from.end());
+        from.resize(from.size() - drop);
+        empty_squares += from.empty();
     }
     if(uncrush == true) {
         assert(board[x][y].back() == BLACK_CRUSH or board[x][y].back() == WHITE_CRUSH);
@@ -218,10 +311,12 @@ void Board::undo_motion(Move move, bool white, bool uncrush) {
         // cerr << "uncrushed at x = " << x << ", y = " << y << "\n";
         board[x][y].back() = (board[x][y].back() == BLACK_CRUSH) ? BLACK_WALL : WHITE_WALL;
     }
+    count_motion_tops(move, +1);
     assert(this->white(x0, y0) == white);
 }
 
 bool Board::perform_move(const Move &move, bool white) {
+    roads_valid = false;
     if(move[0] == 'F' || move[0] == 'S' || move[0] == 'C')
         return perform_placement(move, white);
     else
@@ -229,6 +324,7 @@ bool Board::perform_move(const Move &move, bool white) {
 }
 
 void Board::undo_move(const Move &move, bool white, bool uncrush) {
+    roads_valid = false;
     if(move[0] == 'F' || move[0] == 'S' || move[0] == 'C') {
         assert(uncrush == false);
         return undo_placement(move, white);
@@ -237,72 +333,21 @@ void Board::undo_move(const Move &move, bool white, bool uncrush) {
 }
 
 bool Board::player_road_win(const bool player_color) const {
-    bool reach[N][N];
-    memset(reach, false, sizeof(reach));
-    for(int x = 0; x < N; ++x) {
-        if(x == 0) for(int y = 0; y < N; ++y) {
-            reach[x][y] = (road_piece(x, y) and (white(x, y) == player_color));
-        }
-        else {
-            assert(x >= 1 && x < N);
-            for(int y = 0; y < N; ++y) {
-                reach[x][y] |= reach[x-1][y] and (road_piece(x, y) and (white(x, y) == player_color));
-            }
-            for(int y = 1; y < N; ++y) {
-                reach[x][y] |= reach[x][y-1] and (road_piece(x, y) and (white(x, y) == player_color));
-            }
-            for(int y = N-2; y >= 0; --y) {
-                reach[x][y] |= reach[x][y+1] and (road_piece(x, y) and (white(x, y) == player_color));
-            }
-        }
-    }
-    bool game_over = false;
-    for(int y = 0; y < N; ++y) game_over = game_over or reach[N-1][y];
-    if(game_over) return true;
-    memset(reach, false, sizeof(reach));
-    for(int y = 0; y < N; ++y) {
-        if(y == 0) for(int x = 0; x < N; ++x) {
-            reach[x][y] = (road_piece(x, y) and (white(x, y) == player_color));
-        }
-        else {
-            assert(y >= 1 and y < N);
-            for(int x = 0; x < N; ++x) {
-                reach[x][y] |= reach[x][y-1] and (road_piece(x, y) and (white(x, y) == player_color));
-            }
-            for(int x = 1; x < N; ++x) {
-                reach[x][y] |= reach[x-1][y] and (road_piece(x, y) and (white(x, y) == player_color));
-            }
-            for(int x = N-2; x >= 0; --x) {
-                reach[x][y] |= reach[x+1][y] and (road_piece(x, y) and (white(x, y) == player_color));
-            }
-        }
-    }
-    for(int x = 0; x < N; ++x) game_over = game_over or reach[x][N-1];
-    return game_over;
+    return has_road(road_map(player_color).road);
 }
 
 bool Board::game_flat_win() const {
-    bool space_found = false;
-    for(int x = 0; x < N; ++x) {
-        for(int y = 0; y < N; ++y) {
-            if(empty(x, y)) return false;
-        }
-    }
-    return true;
+    /* the game also ends once either player has placed all their stones */
+    return empty_squares == 0
+        or (white_flats_rem == 0 and white_caps_rem == 0)
+        or (black_flats_rem == 0 and black_caps_rem == 0);
 }
 
 bool Board::player_flat_win(const bool player_color) const {
     // assumes that flat win holds
-    // assumes that top of stack color means that you own the piece
     // returns true if the player draws or wins
-    int black_squares = 0, white_squares = 0;
-    for(int x = 0; x < N; ++x) {
-        for(int y = 0; y < N; ++y) {
-            if(white(x, y)) white_squares++;
-            else if(black(x, y)) black_squares++;
-            else assert(empty(x, y));
-        }
-    }
+    /* only flats count, walls and capstones on top do not */
+    const int black_squares = flat_tops[0], white_squares = flat_tops[1];
     if(black_squares != white_squares)
         return ((black_squares < white_squares) == player_color);
     else if(black_flats_rem != white_flats_rem)
@@ -311,40 +356,123 @@ bool Board::player_flat_win(const bool player_color) const {
         return true;
 }
 
+bool Board::playable(const Move &move, const bool white) const {
+    /* checks what perform_move would otherwise assert on */
+    if(move.size() < 3) return false;
+    const pair<int, int> xy = make_xy(move[1], move[2]);
+    int x = xy.first, y = xy.second;
+    if(out_of_bounds(x, y)) return false;
+    if(move[0] == 'F' or move[0] == 'S' or move[0] == 'C') {
+        const int flats = white ? white_flats_rem : black_flats_rem;
+        const int caps = white ? white_caps_rem : black_caps_rem;
+        return empty(x, y) and ((move[0] == 'C') ? caps : flats) > 0;
+    }
+    const int h = move[0] - '0';
+    if(move.size() < 5 or h < 1 or h > N or h > height(x, y)) return false;
+    if(this->white(x, y) != white) return false;
+    const bool cap = caps(x, y);
+    int carried = h;
+    for(int i = 4; i < (int)move.size(); ++i) {
+        const int drop = move[i] - '0';
+        if(drop < 1 or drop > carried or string("+-<>").find(move[3]) == string::npos) return false;
+        x = next_x(x, move[3]), y = next_y(y, move[3]);
+        if(out_of_bounds(x, y) or caps(x, y)) return false;
+        /* only a lone capstone may flatten a wall */
+        if(wall(x, y) and not (cap and carried == 1)) return false;
+        carried -= drop;
+    }
+    return carried == 0;
+}
+
 string Board::board_to_string() const {
     string s = "";
-    for(int x = 0; x < N; ++x) {
-        for(int y = 0; y < N; ++y) {
-            for(int h = 0; h < board[x][y].size(); ++h) {
-                switch(board[x][y][h]) {
-                    case WHITE_FLAT:
-                    case WHITE_CRUSH: s += 'a'; break;
-                    case WHITE_CAP: s += 'b'; break;
-                    case WHITE_WALL: s += 'c'; break;
-                    case BLACK_FLAT:
-                    case BLACK_CRUSH: s += 'x'; break;
-                    case BLACK_CAP: s += 'y'; break;
-                    case BLACK_WALL: s += 'z'; break;
+    s.reserve(64);
+    write_string(s);
+    return s;
+}
+
+bool Board::load_tps(const string &tps, bool &white_to_move) {
+    /* reads `x5/x5/x2,12S,x2/x5/x5 1 3`, rows from the top rank down */
+    roads_valid = false;
+    for(int x = 0; x < N; ++x)
+        for(int y = 0; y < N; ++y)
+            board[x][y].clear();
+    int white_stones = 0, black_stones = 0;
+    int white_caps = 0, black_caps = 0;
+    int x = 0, y = N - 1;
+    size_t i = 0;
+    for(; i < tps.size() and tps[i] != ' '; ++i) {
+        const char c = tps[i];
+        if(c == '/') {
+            if(x != N) return false;
+            x = 0, --y;
+        }
+        else if(c == ',') continue;
+        else if(c == 'x') {
+            int run = 1;
+            if(i + 1 < tps.size() and isdigit(tps[i+1])) run = tps[++i] - '0';
+            x += run;
+        }
+        else if(c == '1' or c == '2') {
+            if(out_of_bounds(x, y)) return false;
+            for(; i < tps.size() and (tps[i] == '1' or tps[i] == '2'); ++i) {
+                board[x][y].push_back(tps[i] == '1' ? WHITE_FLAT : BLACK_FLAT);
+                (tps[i] == '1') ? ++white_stones : ++black_stones;
+            }
+            if(i < tps.size() and (tps[i] == 'S' or tps[i] == 'C')) {
+                const bool top_white = (board[x][y].back() == WHITE_FLAT);
+                if(tps[i] == 'S') board[x][y].back() = top_white ? WHITE_WALL : BLACK_WALL;
+                else {
+                    board[x][y].back() = top_white ? WHITE_CAP : BLACK_CAP;
+                    top_white ? ++white_caps : ++black_caps;
                 }
             }
-            s += 'p';
+            else --i;
+            ++x;
         }
+        else return false;
     }
-    return s;
+    if(x != N or y != 0) return false;
+    /* the side to move follows the board, white when it is left out */
+    int to_move = 1;
+    istringstream rest(tps.substr(i));
+    if(not (rest >> to_move)) to_move = 1;
+    if(to_move != 1 and to_move != 2) return false;
+    white_to_move = (to_move == 1);
+    white_flats_rem = 21 - (white_stones - white_caps);
+    black_flats_rem = 21 - (black_stones - black_caps);
+    white_caps_rem = 1 - white_caps;
+    black_caps_rem = 1 - black_caps;
+    empty_squares = 0;
+    flat_tops[0] = flat_tops[1] = 0;
+    for(int x = 0; x < N; ++x)
+        for(int y = 0; y < N; ++y) {
+            empty_squares += empty(x, y);
+            count_flat_top(x, y, +1);
+        }
+    return white_flats_rem >= 0 and black_flats_rem >= 0
+        and white_caps_rem >= 0 and black_caps_rem >= 0;
 }
 
-void Board::dfs(const int x, const int y, LRUD &lrud, const bool player_color) const {
-    visit[x][y] = true;
-    lrud.l = min(lrud.l, x);
-    lrud.r = max(lrud.r, x);
-    lrud.d = min(lrud.d, y);
-    lrud.u = max(lrud.u, y);
-    int neighbour[4][2] = {{x+1, y}, {x-1, y}, {x, y-1}, {x, y+1}};
-    for(int i = 0; i < 4; ++i) {
-        const int xp = neighbour[i][0];
-        const int yp = neighbour[i][1];
-        if((not out_of_bounds(xp, yp)) and (not visit[xp][yp]) and (not empty(xp, yp)) and (white(xp, yp) == player_color)) {
-            dfs(xp, yp, lrud, player_color);
+string Board::to_tps(const bool white_to_move, const int move_number) const {
+    string s;
+    for(int y = N - 1; y >= 0; --y) {
+        int run = 0;
+        for(int x = 0; x < N; ++x) {
+            if(empty(x, y)) {
+                ++run;
+                continue;
+            }
+            if(run) s += "x" + (run > 1 ? to_string(run) : "") + ",";
+            run = 0;
+            for(auto stone : board[x][y]) s += check_white(stone) ? '1' : '2';
+            if(wall(x, y)) s += 'S';
+            else if(caps(x, y)) s += 'C';
+            s += ',';
         }
+        if(run) s += "x" + (run > 1 ? to_string(run) : "") + ",";
+        s.back() = '/';
     }
+    s.back() = ' ';
+    return s + (white_to_move ? "1 " : "2 ") + to_string(move_number);
 }
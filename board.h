@@ -1,3 +1,6 @@
+#ifndef BOARD_H
+#define BOARD_H
+
 #include "utility.h"
 #include <iostream>
 #include <cstring>
@@ -15,38 +18,109 @@ struct LRUD {
     int l, r, u, d;
 };
 
+/* one bit per square, bit x * N + y */
+typedef int32 Bitboard;
+
+/* road structure of one player, derived from its connected groups */
+struct RoadMap {
+    /* squares whose top stone counts for the player's road */
+    Bitboard road = 0;
+    /* empty squares where a single placement completes a road */
+    Bitboard threats = 0;
+    /* bounding-box span score of the player's groups, see evaluate_components */
+    int span_score = 0;
+};
+
 const int N = 5;
+
+inline Bitboard square_bit(const int x, const int y) {
+    return Bitboard(1) << (x * N + y);
+}
+/* whether the squares of `road` connect two opposite edges */
+bool has_road(const Bitboard road);
+/* at or below these a single placement can end the game */
+const int LAST_PLACEMENT_EMPTY = 1;
+const int LAST_PLACEMENT_RESERVE = 1;
+/* at or below these the game is close enough to its end to be solved */
+const int ENDGAME_EMPTY = 4;
+const int ENDGAME_RESERVE = 4;
 class Board {
     /* searches for a road win by `player color` */
 
     int evaluate_captives(const bool player_color) const;
     int evaluate_tops(const bool player_color) const;
     int evaluate_central_control(const bool player_color) const;
+    int evaluate_threats(const bool player_color) const;
 
     /* perform the two types of moves */
-    bool perform_placement(Move move, bool white);
-    bool perform_motion(Move move, bool white);
+    bool perform_placement(const Move &move, bool white);
+    bool perform_motion(const Move &move, bool white);
 
     /* undo the two types of moves */
-    void undo_placement(Move move, bool white);
-    void undo_motion(Move move, bool white, bool uncrush);
+    void undo_placement(const Move &move, bool white);
+    void undo_motion(const Move &move, bool white, bool uncrush);
+
+    /* flats on top of a stack of black and white, kept by every move */
+    int flat_tops[2] = {0, 0};
+    /* adds `sign` to the count of the top of (x, y) if it is a flat */
+    void count_flat_top(const int x, const int y, const int sign) {
+        if(board[x][y].empty()) return;
+        const Stones top = board[x][y].back();
+        if(top == WHITE_FLAT or top == WHITE_CRUSH) flat_tops[1] += sign;
+        else if(top == BLACK_FLAT or top == BLACK_CRUSH) flat_tops[0] += sign;
+    }
+    /* the same for the source and every square the stones of `move` drop on */
+    void count_motion_tops(const Move &move, const int sign);
+
+    /* road maps of black and white, rebuilt on first use after a move */
+    mutable RoadMap road_maps[2];
+    mutable bool roads_valid = false;
+    void build_roads(const bool player_color, RoadMap &roads) const;
 public:
     bool player_road_win(const bool player_color) const;
     bool player_flat_win(const bool player_color) const;
     bool game_flat_win() const;
     string board_to_string() const;
+    /* appends the stacks of board_to_string to `s`, which may keep its buffer */
+    template <typename String>
+    void write_string(String &s) const;
+    /* replaces the position with a TPS string, false if it is not one */
+    bool load_tps(const string &tps, bool &white_to_move);
+    string to_tps(const bool white_to_move, const int move_number) const;
     /* for debugging purposes, they are outside */
     vector<Stones> board[5][5];
     int white_flats_rem = 21;
     int white_caps_rem = 1;
     int black_flats_rem = 21;
     int black_caps_rem = 1;
+    /* kept up to date by perform_move and undo_move */
+    int empty_squares = N * N;
+    /* stacks topped by a flat of `player_color`, walls and capstones do not count */
+    int flat_count(const bool player_color) const {
+        return flat_tops[player_color];
+    }
 
+    /* whether `white` may play `move` here, perform_move asserts on the rest */
+    bool playable(const Move &move, const bool white) const;
+    /* a road or a flat win has ended the game */
+    bool game_over() const {
+        return road_win() or game_flat_win();
+    }
+    /* room in every stack for all the stones of the game, so that moves
+       never grow a stack; copies of the board do not keep it */
+    void reserve_stacks() {
+        const size_t stones = 2 * (21 + 1);  /* flats and capstone of each side */
+        for(auto &row : board) for(auto &stack : row) stack.reserve(stones);
+    }
     /* move on the board, returns if it did crush a wall */
     bool perform_move(const Move &move, bool white);
     /* undo the above move */
     void undo_move(const Move &move, bool white, bool uncrush);
 
+    /* drops the road maps as a move would, so the next use rebuilds them */
+    void forget_roads() const {
+        roads_valid = false;
+    }
     /* evaluates the move */
     int evaluate(const bool player_color) const;
     int evaluate_helper(const bool player_color) const;
@@ -57,6 +131,18 @@ public:
         return board[x][y].empty();
     }
 
+    bool last_placement_near() const {
+        return empty_squares <= LAST_PLACEMENT_EMPTY
+            or white_flats_rem + white_caps_rem <= LAST_PLACEMENT_RESERVE
+            or black_flats_rem + black_caps_rem <= LAST_PLACEMENT_RESERVE;
+    }
+
+    bool endgame_near() const {
+        return empty_squares <= ENDGAME_EMPTY
+            or white_flats_rem + white_caps_rem <= ENDGAME_RESERVE
+            or black_flats_rem + black_caps_rem <= ENDGAME_RESERVE;
+    }
+
     bool road_win() const {
         /* this game over simply tells you if the game is over */
         /* it does not tell you who won */
@@ -113,6 +199,32 @@ public:
     int height(int x, int y) const {
         return board[x][y].size();
     }
-    void dfs(const int x, const int y, LRUD &lrud, const bool player_color) const;
     int evaluate_components(const bool player_color) const;
+    const RoadMap &road_map(const bool player_color) const;
+    Bitboard road_threats(const bool player_color) const {
+        return road_map(player_color).threats;
+    }
 };
+
+template <typename String>
+void Board::write_string(String &s) const {
+    for(int x = 0; x < N; ++x) {
+        for(int y = 0; y < N; ++y) {
+            for(int h = 0; h < board[x][y].size(); ++h) {
+                switch(board[x][y][h]) {
+                    case WHITE_FLAT:
+                    case WHITE_CRUSH: s += 'a'; break;
+                    case WHITE_CAP: s += 'b'; break;
+                    case WHITE_WALL: s += 'c'; break;
+                    case BLACK_FLAT:
+                    case BLACK_CRUSH: s += 'x'; break;
+                    case BLACK_CAP: s += 'y'; break;
+                    case BLACK_WALL: s += 'z'; break;
+                }
+            }
+            s += 'p';
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,200 @@
+#include "search.h"
+#include <iostream>
+#include <random>
+#include <set>
+using namespace std;
+
+/*
+ * Checks the fast road detectors against brute force over the positions of
+ * seeded random games: the threat map of each side against trying a flat on
+ * every empty square, and find_winning_moves against playing every legal
+ * move. The kept flat counts are checked against the stacks, and the
+ * endgame solver against a plain minimax over every move. Exits with 1 if
+ * any of them disagree.
+ *   cross_check
+ */
+
+/* plays a random game of at most `plies` plies, calling `visit` before each */
+template <typename F>
+void random_game(mt19937 &rng, const int plies, F visit) {
+    Board board;
+    bool white = true;
+    Moves moves;
+    for(int ply = 0; ply < plies and not board.game_over(); ++ply) {
+        visit(board, white);
+        moves.clear();
+        generate_moves(board, moves, white);
+        board.perform_move(moves[rng() % moves.size()], white);
+        white = not white;
+    }
+}
+
+/* a road found by walking from every square of one edge, square by square */
+bool brute_road_win(const Board &board, const bool player_color) {
+    for(const bool columns : {false, true}) {
+        bool seen[N][N] = {};
+        vector<pair<int, int>> todo;
+        for(int i = 0; i < N; ++i) todo.push_back(columns ? make_pair(0, i) : make_pair(i, 0));
+        while(not todo.empty()) {
+            const int x = todo.back().first, y = todo.back().second;
+            todo.pop_back();
+            if(x < 0 or x >= N or y < 0 or y >= N or seen[x][y]) continue;
+            if(not board.road_piece(x, y) or board.white(x, y) != player_color) continue;
+            seen[x][y] = true;
+            if((columns ? x : y) == N-1) return true;
+            todo.push_back(make_pair(x+1, y));
+            todo.push_back(make_pair(x-1, y));
+            todo.push_back(make_pair(x, y+1));
+            todo.push_back(make_pair(x, y-1));
+        }
+    }
+    return false;
+}
+
+Bitboard brute_threats(Board &board, const bool player_color) {
+    const int left = player_color ? board.white_flats_rem + board.white_caps_rem
+                                  : board.black_flats_rem + board.black_caps_rem;
+    /* the threat map ignores the reserve, so lend the player the flat it places */
+    int &flats = player_color ? board.white_flats_rem : board.black_flats_rem;
+    Bitboard threats = 0;
+    for(int x = 0; x < N; ++x) for(int y = 0; y < N; ++y) {
+        if(not board.empty(x, y) or left == 0) continue;
+        const Move move = "F" + make_sqr(x, y);
+        ++flats;
+        board.perform_move(move, player_color);
+        if(brute_road_win(board, player_color)) threats |= square_bit(x, y);
+        board.undo_move(move, player_color, false);
+        --flats;
+    }
+    return threats;
+}
+
+set<Move> brute_wins(Board &board, const bool white) {
+    Moves moves;
+    generate_moves(board, moves, white);
+    set<Move> wins;
+    for(const auto &move : moves) {
+        const bool did_crush = board.perform_move(move, white);
+        if(brute_road_win(board, white)) wins.insert(move);
+        board.undo_move(move, white, did_crush);
+    }
+    /* find_winning_moves names one placement per square: the flat, or the
+       capstone when no flat is left */
+    set<Move> named;
+    for(const auto &move : wins) {
+        if(move[0] == 'S') continue;
+        if(move[0] == 'C' and wins.count("F" + move.substr(1))) continue;
+        named.insert(move);
+    }
+    return named;
+}
+
+int brute_flats(const Board &board, const bool player_color) {
+    int flats = 0;
+    for(int x = 0; x < N; ++x) for(int y = 0; y < N; ++y)
+        flats += player_color ? (board.white_flat(x, y) or board.white_crush(x, y))
+                              : (board.black_flat(x, y) or board.black_crush(x, y));
+    return flats;
+}
+
+/* the outcome for `to_move` over every line of `plies` plies, no table or pruning */
+Outcome brute_outcome(Board &board, const bool to_move, const int plies) {
+    int over;
+    if(game_over_value(board, to_move, not to_move, over))
+        return (over == 0) ? OUTCOME_DRAW : (over > 0 ? OUTCOME_WIN : OUTCOME_LOSS);
+    if(plies == 0) return OUTCOME_UNKNOWN;
+    Moves moves;
+    generate_moves(board, moves, to_move);
+    Outcome result = OUTCOME_LOSS;
+    bool unknown = false;
+    for(const auto &move : moves) {
+        const bool did_crush = board.perform_move(move, to_move);
+        const Outcome reply = brute_outcome(board, not to_move, plies - 1);
+        board.undo_move(move, to_move, did_crush);
+        if(reply == OUTCOME_UNKNOWN) unknown = true;
+        else result = max(result, (Outcome)-reply);
+        if(result == OUTCOME_WIN) return result;
+    }
+    return unknown ? OUTCOME_UNKNOWN : result;
+}
+
+int main() {
+    long long positions = 0, threats = 0, bad_threats = 0, bad_flats = 0;
+    mt19937 threat_rng(1);
+    for(int game = 0; game < 3000; ++game) {
+        random_game(threat_rng, 80, [&](Board &board, const bool white) {
+            for(const bool color : {false, true}) {
+                const Bitboard brute = brute_threats(board, color);
+                ++positions;
+                threats += __builtin_popcount(brute);
+                if(brute == board.road_threats(color)) continue;
+                if(bad_threats++ == 0) cout << "threat map differs on " << board.to_tps(white, 1) << "\n";
+            }
+            for(const bool color : {false, true}) {
+                if(board.flat_count(color) == brute_flats(board, color)) continue;
+                if(bad_flats++ == 0) cout << "flat count differs on " << board.to_tps(white, 1) << "\n";
+            }
+        });
+    }
+    cout << "threat maps: " << positions << " checked, " << threats << " threats, "
+         << bad_threats << " wrong\n";
+    cout << "flat counts: " << bad_flats << " wrong\n";
+
+    long long checked = 0, wins = 0, bad_wins = 0;
+    mt19937 win_rng(7);
+    for(int game = 0; game < 4000; ++game) {
+        random_game(win_rng, 120, [&](Board &board, const bool white) {
+            const set<Move> brute = brute_wins(board, white);
+            Moves found;
+            find_winning_moves(board, white, found);
+            ++checked;
+            wins += brute.size();
+            if(brute == set<Move>(found.begin(), found.end())) return;
+            if(bad_wins++ == 0) cout << "winning moves differ on " << board.to_tps(white, 1) << "\n";
+        });
+    }
+    cout << "winning moves: " << checked << " checked, " << wins << " wins, "
+         << bad_wins << " wrong\n";
+
+    /* games that place more than they spread, so that they reach their end */
+    const int SOLVE_PLIES = 3;
+    long long solved = 0, proven = 0, bad_solves = 0;
+    mt19937 solve_rng(5);
+    for(int game = 0; game < 300; ++game) {
+        Board board;
+        bool white = true;
+        Moves moves;
+        while(not board.game_over()) {
+            if(board.endgame_near() and solve_rng() % 4 == 0) {
+                clear_tables();
+                Move best;
+                const Outcome outcome = solve_endgame(board, white, SOLVE_PLIES, best);
+                const Outcome brute = brute_outcome(board, white, SOLVE_PLIES);
+                ++solved;
+                bool wrong = false;
+                if(outcome != OUTCOME_UNKNOWN and brute != OUTCOME_UNKNOWN) {
+                    ++proven;
+                    wrong = (outcome != brute);
+                }
+                if(outcome == OUTCOME_WIN) {
+                    /* the move it found must leave the other side lost */
+                    const bool did_crush = board.perform_move(best, white);
+                    const Outcome reply = brute_outcome(board, not white, SOLVE_PLIES - 1);
+                    board.undo_move(best, white, did_crush);
+                    wrong = wrong or (reply != OUTCOME_LOSS and reply != OUTCOME_UNKNOWN);
+                }
+                if(wrong and bad_solves++ == 0) cout << "endgame solve differs on " << board.to_tps(white, 1) << "\n";
+                break;
+            }
+            moves.clear();
+            generate_moves(board, moves, white);
+            Move move = moves[solve_rng() % moves.size()];
+            for(int tries = 0; tries < 3 and move[0] != 'F'; ++tries) move = moves[solve_rng() % moves.size()];
+            board.perform_move(move, white);
+            white = not white;
+        }
+    }
+    cout << "endgame solves: " << solved << " checked, " << proven << " proven by both, "
+         << bad_solves << " wrong\n";
+    return (bad_threats or bad_flats or bad_wins or bad_solves) ? 1 : 0;
+}
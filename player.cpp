@@ -4,15 +4,15 @@
 #include <cstdint>
 #include <cassert>
 #include <ctime>
-#include "board.h"
-#include <unordered_map>
+#include <cstdlib>
+#include <thread>
+#include "search.h"
+#include "server.h"
+#include "batch.h"
+#include "trace.h"
 
 using namespace std;
 
-typedef unordered_map<string, pair<pair<Move, int>, int> > tranposition_table;
-tranposition_table max_table;
-tranposition_table min_table;
-
 void print_board(const Board &board) {
     for(int j = N - 1; j >= 0; --j) {
         for(int i = 0; i < N; ++i) {
@@ -36,211 +36,43 @@ void print_board(const Board &board) {
         cerr << "\n";
     }
 }
-void generate_placement_moves(const Board &board, Moves &moves, const bool white);
-void generate_motion_moves(const Board &board, Moves &moves, const bool white);
-void motion(const char dir, const int x, const int y, string prefix, const Board &board, Moves &moves, const int ht);
-void cap_motion(const char dir, const int x, const int y, string prefix, const Board &board, Moves &moves, const int ht);
-/* declaration of the new functions */
-const pair<Move, int> alpha_beta_search(Board &board, const int cutoff, const bool player_color);
-const pair<Move, int> max_value(Board &board, int alpha, int beta, const int cutoff, const bool player_color);
-const pair<Move, int> min_value(Board &board, int alpha, int beta, const int cutoff, const bool player_color);
-
-//=========================================================
-
-void generate_moves(const Board &board, Moves &moves, const bool white) {
-    /* generates a list of moves for either player and prints them out */
-    generate_placement_moves(board, moves, white);
-    generate_motion_moves(board, moves, white);
-    // print_moves(moves);
-}
-
-void generate_placement_moves(const Board &board, Moves &moves, const bool white) {
-    /* generates moves to place pieces for white and black */
-    const int flats = (white) ? board.white_flats_rem : board.black_flats_rem;
-    const int caps = (white) ? board.white_caps_rem : board.black_caps_rem;
-    for(int x = 0; x < N; ++x) {
-        for(int y = 0; y < N; ++y) {
-            if(board.empty(x, y)) {
-                string s = make_sqr(x, y);
-                if(flats > 0) {
-                    moves.push_back((const string)("S" + s));
-                    moves.push_back((const string)("F" + s));
-                }
-                if(caps > 0) {
-                    moves.push_back("C" + s);
-                }
-            }
-        }
-    }
-}
-
-void generate_motion_moves(const Board &board, Moves &moves, const bool white) {
-    /* generate the moves for moving stacks for either player */
-    const string dirs = "+-<>";
-    for(int dir = 0; dir < 4; ++dir) {
-        for(int x = 0; x < N; ++x) {
-            for(int y = 0; y < N; ++y) {
-                if(board.empty(x, y)) continue;
-                const int xx = next_x(x, dirs[dir]);
-                const int yy = next_y(y, dirs[dir]);
-                /* some predicates for testing the exitence of players' stack */
-                const bool white_cap = (white and board.white_cap(x, y));
-                const bool black_cap = ((not white) and board.black_cap(x, y));
-                const bool white_stack = (white and (board.white_flat(x, y) or board.white_wall(x, y)));
-                const bool black_stack = ((not white) and ((board.black_flat(x, y) or board.black_wall(x, y))));
-                const int H = board.height(x, y);
-                /* because there is a carry limit */
-                for(int h = 1; h <= min(H, N); ++h) {
-                    string prefix = to_string(h) + make_sqr(x, y) + dirs[dir];
-                    if(white_stack or black_stack) {
-                        /* there is a stack for the player which he might move */
-                        motion(dirs[dir], xx, yy, prefix, board, moves, h);
-                    }
-                    else if(white_cap or black_cap) {
-                        /* there is a capstone stack for the player which he might move */
-                        cap_motion(dirs[dir], xx, yy, prefix, board, moves, h);
-                    }
-                }
-            }
-        }
-    }
-}
-
-void motion(const char dir, const int x, const int y, string prefix, const Board &board, Moves &moves, const int ht) {
-    if(out_of_bounds(x, y)) return;
-    if(board.white_cap(x, y) || board.black_cap(x, y)) return;
-    if(board.white_wall(x, y) || board.black_wall(x, y)) return;
-    moves.push_back(prefix + to_string(ht));
-    int xx = next_x(x, dir);
-    int yy = next_y(y, dir);
-    for(int h = 1; h < ht; ++h) {
-        motion(dir, xx, yy, prefix + to_string(h), board, moves, ht - h);
-    }
-}
 
-void cap_motion(const char dir, const int x, const int y, string prefix, const Board &board, Moves &moves, const int ht) {
-    if(out_of_bounds(x, y)) return;
-    if(board.white_cap(x, y) || board.black_cap(x, y)) return;
-    if((board.white_wall(x, y) || board.black_wall(x, y)) and ht > 1) return;
-    moves.push_back(prefix + to_string(ht));
-    int xx = next_x(x, dir);
-    int yy = next_y(y, dir);
-    for(int h = 1; h < ht; ++h) {
-        cap_motion(dir, xx, yy, prefix + to_string(h), board, moves, ht - h);
+int main(int argc, char *argv[]) {
+    /* TAKTICS_TRACE=file records every node searched on this thread, read it with taktics_trace */
+    if(getenv("TAKTICS_TRACE") != NULL) {
+        const char *records = getenv("TAKTICS_TRACE_RECORDS");
+        start_trace(getenv("TAKTICS_TRACE"), records ? strtoull(records, NULL, 10) : (1ull << 22));
     }
-}
-
-const pair<Move, int> alpha_beta_search(Board &board, const int cutoff, const bool player_color) {
-    return max_value(board, INT_MIN, INT_MAX, cutoff, player_color);
-}
-
-
-const pair<Move, int> max_value(Board &board, int alpha, int beta, const int cutoff, const bool player_color) {
-    /* memoized in the hash table */
-    const string hash_string = board.board_to_string();
-    if(max_table.count(hash_string) == 1) {
-        auto memo = max_table[hash_string];
-        if(memo.second >= cutoff) {
-            return memo.first;
-        }
-    }
-    /* has the other player won the game ? */
-    if(board.player_road_win(not player_color)) return make_pair("", INT_MIN);
-    if(board.player_road_win(player_color)) return make_pair("", INT_MAX);
-    if(board.game_flat_win()) {
-        const bool player_win = board.player_flat_win(player_color);
-        const bool other_win = board.player_flat_win(not player_color);
-        if(player_win) return make_pair("", INT_MAX);
-        if(other_win) return make_pair("", INT_MIN);
-    }
-    if(cutoff <= 0) return make_pair("", board.evaluate(player_color));
-
-    /* iterative deepening code */
-    int value = INT_MIN;
-    Move optimal_move;
-    vector<Move> moves;
-    generate_moves(board, moves, player_color);
-    vector<pair<int, Move> > order;
-    for(const auto &move : moves) {
-        const bool did_crush = board.perform_move(move, player_color);
-        const int value = min_value(board, alpha, beta, cutoff-3, player_color).second;
-        board.undo_move(move, player_color, did_crush);
-        order.push_back(make_pair(value, move));
-    }
-    /* sorts them according to order */
-    sort(order.rbegin(), order.rend());
-    /* main alpha beta code */
-    for(const auto &order_pair : order) {
-        const auto move = order_pair.second;
-        const bool did_crush = board.perform_move(move, player_color);
-        int move_min_value = min_value(board, alpha, beta, cutoff-1, player_color).second;
-        if(value < move_min_value) {
-          value = move_min_value;
-          optimal_move = move;
+    /* `player --server [max_entries] [--threads T]` hosts many games in this one process */
+    if(argc > 1 and string(argv[1]) == "--server") {
+        size_t max_entries = (size_t)1e7;
+        int threads = max(1, (int)thread::hardware_concurrency());
+        for(int i = 2; i < argc; ++i) {
+            const string arg = argv[i];
+            if(arg == "--threads" and i + 1 < argc) threads = max(1, atoi(argv[++i]));
+            else max_entries = strtoull(argv[i], NULL, 10);
         }
-        board.undo_move(move, player_color, did_crush);
-        if(value >= beta) return make_pair(move, value);
-        alpha = max(alpha, value);
+        return run_server(max_entries, threads);
     }
-    pair<Move, int> move_pair = make_pair(optimal_move, value);
-    return move_pair;
-}
-
-const pair<Move, int> min_value(Board &board, int alpha, int beta, const int cutoff, const bool player_color) {
-    /* memoized in the hash table */
-    const string hash_string = board.board_to_string();
-    if(min_table.count(hash_string) == 1) {
-        auto memo = min_table[hash_string];
-        if(memo.second >= cutoff) {
-            return memo.first;
-        }
-    }
-    /* has the other player won the game */
-    if(board.player_road_win(player_color)) return make_pair("", INT_MAX);
-    if(board.player_road_win(not player_color)) return make_pair("", INT_MIN);
-    if(board.game_flat_win()) {
-        const bool player_win = board.player_flat_win(player_color);
-        const bool other_win = board.player_flat_win(not player_color);
-        if(player_win) return make_pair("", INT_MAX);
-        if(other_win) return make_pair("", INT_MIN);
-    }
-    if(cutoff <= 0) return make_pair("", board.evaluate(player_color));
-    /* iterative deepening code*/
-    int value = INT_MAX;
-    Move optimal_move;
-    vector<Move> moves;
-    generate_moves(board, moves, not player_color);
-    vector<pair<int, Move> > order;
-    for(const auto &move : moves) {
-        const bool did_crush = board.perform_move(move, not player_color);
-        const int value = max_value(board, alpha, beta, cutoff-3, player_color).second;
-        board.undo_move(move, not player_color, did_crush);
-        order.push_back(make_pair(value, move));
-    }
-    sort(order.begin(), order.end());
-    /* main alpha beta */
-    for(const auto &order_pair : order) {
-        const auto move = order_pair.second;
-        const bool did_crush = board.perform_move(move, not player_color);
-        int move_max_value = max_value(board, alpha, beta, cutoff-1, player_color).second;
-        if(value > move_max_value) {
-          value = move_max_value;
-          optimal_move = move;
+    /* `player --batch [file] [--threads T] [--depth D] [--nodes N] [--time MS] [--table E]` */
+    if(argc > 1 and string(argv[1]) == "--batch") {
+        string path = "-";
+        BatchOptions options;
+        for(int i = 2; i < argc; ++i) {
+            const string arg = argv[i];
+            const bool has_value = (i + 1 < argc);
+            if(arg == "--threads" and has_value) options.threads = atoi(argv[++i]);
+            else if(arg == "--depth" and has_value) options.depth = atoi(argv[++i]);
+            else if(arg == "--nodes" and has_value) options.nodes = atoll(argv[++i]);
+            else if(arg == "--time" and has_value) options.millis = atoi(argv[++i]);
+            else if(arg == "--table" and has_value) options.table_entries = strtoull(argv[++i], NULL, 10);
+            else path = arg;
         }
-        board.undo_move(move, not player_color, did_crush);
-        if(value <= alpha) return make_pair(move, value);
-        beta = min(beta, value);
+        /* with no limit at all, analyse as deep as a move in a game */
+        if(options.depth == 0 and options.nodes == 0 and options.millis == 0) options.depth = 5;
+        return run_batch(path, options);
     }
-    // cerr << "MIN choice = " << optimal_move << " , " << value << "\n";
-    pair<Move, int> move_pair = make_pair(optimal_move, value);
-    min_table.insert(make_pair(hash_string, make_pair(move_pair, cutoff)));
-    return move_pair;
-}
-
-
-
 
-int main() {
      // testing
     //  vector<Move> moves;
     //  Board board;
@@ -271,6 +103,7 @@ int main() {
    Board board;
    min_table.reserve((int)1e8);
    max_table.reserve((int)1e8);
+   limit_tables((size_t)1e8);
    int player_number;
    int board_size;
    int time_limit;
@@ -317,7 +150,7 @@ int main() {
 
        if(player_color) {
            clock_t start_time = clock();
-           const auto result = alpha_beta_search(board, depth_play, player_color);
+           const auto result = deepening_search(board, depth_play, player_color);
            cout << result.first << "\n" << flush;
            board.perform_move(result.first, player_color);
            elapsed_time = (int)(double(clock()-start_time) / (double)CLOCKS_PER_SEC);
@@ -333,7 +166,7 @@ int main() {
            board.perform_move((Move)opponent_move, not player_color);
            // print_board(board); // Print board after opponent's move
            clock_t start_time = clock();
-           const auto result = alpha_beta_search(board, depth_play, player_color);
+           const auto result = deepening_search(board, depth_play, player_color);
            cout << result.first << "\n" << flush;
            board.perform_move(result.first, player_color);
            elapsed_time = (int)(double(clock()-start_time) / (double)CLOCKS_PER_SEC);
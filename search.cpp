@@ -0,0 +1,810 @@
+#include "search.h"
+#include "trace.h"
+#include <cassert>
+#include <iostream>
+#include <deque>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+using namespace std;
+
+/* every thread searches with its own tables and scratch space; the arena
+   is declared first so that it outlives the tables */
+thread_local TableArena table_arena;
+thread_local tranposition_table max_table{tranposition_table::allocator_type(&table_arena)};
+thread_local tranposition_table min_table{tranposition_table::allocator_type(&table_arena)};
+thread_local placement_table last_placement_table;
+thread_local endgame_table_type endgame_table;
+/* entries allowed across both tables before they are aged */
+thread_local size_t table_limit = SIZE_MAX;
+thread_local uint16_t search_generation = 0;
+
+const int HISTORY_MAX = 1 << 20;
+thread_local SearchMemory search_memory;
+/* the current search is of root_key, so its root order may be used and kept */
+thread_local bool at_root_key = false;
+/* tried first at the root when the table has no move there */
+thread_local Move root_hint;
+
+thread_local SearchStats search_stats;
+thread_local SearchBudget search_budget;
+
+/* scratch space of each ply, kept across nodes and searches so that the
+   search loop itself does not touch the heap once the arena is warm */
+thread_local deque<Ply> ply_arena;
+thread_local int ply_top = 0;
+
+/* claims the next ply of the arena and releases it when going out of scope */
+struct PlyFrame {
+    Ply &ply;
+    PlyFrame() : ply(claim_ply()) {}
+    ~PlyFrame() { --ply_top; }
+    static Ply &claim_ply() {
+        if(ply_top == (int)ply_arena.size()) ply_arena.emplace_back();
+        Ply &ply = ply_arena[ply_top++];
+        ply.moves.clear();
+        ply.order.clear();
+        ply.wins.clear();
+        ply.known.clear();
+        return ply;
+    }
+};
+
+/* every heap allocation made by this thread, read around a search */
+thread_local long long heap_allocations = 0;
+
+void *operator new(size_t bytes) {
+    ++heap_allocations;
+    if(void *block = malloc(bytes ? bytes : 1)) return block;
+    throw bad_alloc();
+}
+
+void operator delete(void *block) noexcept {
+    free(block);
+}
+
+void generate_placement_moves(const Board &board, Moves &moves, const bool white);
+void generate_motion_moves(const Board &board, Moves &moves, const bool white);
+void motion(const char dir, const int x, const int y, string prefix, const Board &board, Moves &moves, const int ht);
+void cap_motion(const char dir, const int x, const int y, string prefix, const Board &board, Moves &moves, const int ht);
+
+//=========================================================
+
+void generate_moves(const Board &board, Moves &moves, const bool white) {
+    /* generates a list of moves for either player and prints them out */
+    generate_placement_moves(board, moves, white);
+    generate_motion_moves(board, moves, white);
+    // print_moves(moves);
+}
+
+void generate_placement_moves(const Board &board, Moves &moves, const bool white) {
+    /* generates moves to place pieces for white and black */
+    const int flats = (white) ? board.white_flats_rem : board.black_flats_rem;
+    const int caps = (white) ? board.white_caps_rem : board.black_caps_rem;
+    for(int x = 0; x < N; ++x) {
+        for(int y = 0; y < N; ++y) {
+            if(board.empty(x, y)) {
+                string s = make_sqr(x, y);
+                if(flats > 0) {
+                    moves.push_back((const string)("S" + s));
+                    moves.push_back((const string)("F" + s));
+                }
+                if(caps > 0) {
+                    moves.push_back("C" + s);
+                }
+            }
+        }
+    }
+}
+
+void generate_motion_moves(const Board &board, Moves &moves, const bool white) {
+    /* generate the moves for moving stacks for either player */
+    const string dirs = "+-<>";
+    for(int dir = 0; dir < 4; ++dir) {
+        for(int x = 0; x < N; ++x) {
+            for(int y = 0; y < N; ++y) {
+                if(board.empty(x, y)) continue;
+                const int xx = next_x(x, dirs[dir]);
+                const int yy = next_y(y, dirs[dir]);
+                /* some predicates for testing the exitence of players' stack */
+                const bool white_cap = (white and board.white_cap(x, y));
+                const bool black_cap = ((not white) and board.black_cap(x, y));
+                /* a flattened wall on top moves like a flat */
+                const bool white_stack = (white and (board.white_flat(x, y) or board.white_wall(x, y) or board.white_crush(x, y)));
+                const bool black_stack = ((not white) and ((board.black_flat(x, y) or board.black_wall(x, y) or board.black_crush(x, y))));
+                const int H = board.height(x, y);
+                /* because there is a carry limit */
+                for(int h = 1; h <= min(H, N); ++h) {
+                    string prefix = to_string(h) + make_sqr(x, y) + dirs[dir];
+                    if(white_stack or black_stack) {
+                        /* there is a stack for the player which he might move */
+                        motion(dirs[dir], xx, yy, prefix, board, moves, h);
+                    }
+                    else if(white_cap or black_cap) {
+                        /* there is a capstone stack for the player which he might move */
+                        cap_motion(dirs[dir], xx, yy, prefix, board, moves, h);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void motion(const char dir, const int x, const int y, string prefix, const Board &board, Moves &moves, const int ht) {
+    if(out_of_bounds(x, y)) return;
+    if(board.white_cap(x, y) || board.black_cap(x, y)) return;
+    if(board.white_wall(x, y) || board.black_wall(x, y)) return;
+    moves.push_back(prefix + to_string(ht));
+    int xx = next_x(x, dir);
+    int yy = next_y(y, dir);
+    for(int h = 1; h < ht; ++h) {
+        motion(dir, xx, yy, prefix + to_string(h), board, moves, ht - h);
+    }
+}
+
+void cap_motion(const char dir, const int x, const int y, string prefix, const Board &board, Moves &moves, const int ht) {
+    if(out_of_bounds(x, y)) return;
+    if(board.white_cap(x, y) || board.black_cap(x, y)) return;
+    if((board.white_wall(x, y) || board.black_wall(x, y)) and ht > 1) return;
+    moves.push_back(prefix + to_string(ht));
+    int xx = next_x(x, dir);
+    int yy = next_y(y, dir);
+    for(int h = 1; h < ht; ++h) {
+        cap_motion(dir, xx, yy, prefix + to_string(h), board, moves, ht - h);
+    }
+}
+
+void spread_wins(const Board &board, const bool white, const Stones carried[], const int count,
+                 const char dir, const int x, const int y, Bitboard road, string move, Moves &wins) {
+    /* drops the bottom `count` stones still carried onto the squares from (x, y) on */
+    if(out_of_bounds(x, y) or board.caps(x, y)) return;
+    const bool last_is_cap = (carried[count - 1] == WHITE_CAP or carried[count - 1] == BLACK_CAP);
+    if(board.wall(x, y) and not (count == 1 and last_is_cap)) return;
+    for(int drop = 1; drop <= count; ++drop) {
+        const Stones top = carried[drop - 1];
+        const bool road_top = (check_white(top) == white) and top != WHITE_WALL and top != BLACK_WALL;
+        const Bitboard covered = road_top ? (road | square_bit(x, y)) : (road & ~square_bit(x, y));
+        if(drop == count) {
+            if(has_road(covered)) wins.push_back(move + to_string(drop));
+        }
+        else {
+            spread_wins(board, white, carried + drop, count - drop, dir,
+                        next_x(x, dir), next_y(y, dir), covered, move + to_string(drop), wins);
+        }
+    }
+}
+
+void find_winning_moves(const Board &board, const bool white, Moves &wins) {
+    const Bitboard road = board.road_map(white).road;
+    /* placements into a gap, read straight off the threat map */
+    const Bitboard threats = board.road_threats(white);
+    const int flats = white ? board.white_flats_rem : board.black_flats_rem;
+    for(int x = 0; x < N; ++x) {
+        for(int y = 0; y < N; ++y) {
+            if(not (threats & square_bit(x, y))) continue;
+            wins.push_back((flats > 0 ? "F" : "C") + make_sqr(x, y));
+        }
+    }
+    /* spreads, by working out the new top of every square they touch */
+    const string dirs = "+-<>";
+    for(int x = 0; x < N; ++x) {
+        for(int y = 0; y < N; ++y) {
+            if(board.empty(x, y) or board.white(x, y) != white) continue;
+            const vector<Stones> &stack = board.board[x][y];
+            const int H = stack.size();
+            for(int h = 1; h <= min(H, N); ++h) {
+                /* what the source square shows once the top `h` stones are lifted */
+                Bitboard lifted = road & ~square_bit(x, y);
+                if(h < H and check_white(stack[H - h - 1]) == white) lifted |= square_bit(x, y);
+                for(int dir = 0; dir < 4; ++dir) {
+                    spread_wins(board, white, &stack[H - h], h, dirs[dir], next_x(x, dirs[dir]),
+                                next_y(y, dirs[dir]), lifted, to_string(h) + make_sqr(x, y) + dirs[dir], wins);
+                }
+            }
+        }
+    }
+}
+
+/* moves those of `moves` that pass `first` to the front, keeping the order
+   within both parts; rotating costs nothing on the heap, and few move */
+template <typename Predicate>
+void move_to_front(Moves &moves, Predicate first) {
+    auto front = moves.begin();
+    for(auto move = moves.begin(); move != moves.end(); ++move) {
+        if(not first(*move)) continue;
+        rotate(front, move, move + 1);
+        ++front;
+    }
+}
+
+void threats_first(const Board &board, Moves &moves) {
+    /* placements that complete or block a road are tried before the rest */
+    const Bitboard threats = board.road_threats(true) | board.road_threats(false);
+    if(threats == 0) return;
+    move_to_front(moves, [threats](const Move &move) {
+        if(move[0] != 'F' and move[0] != 'S' and move[0] != 'C') return false;
+        const pair<int, int> xy = make_xy(move[1], move[2]);
+        return (threats & square_bit(xy.first, xy.second)) != 0;
+    });
+}
+
+void table_key(const Board &board, const bool player_color, TableKey &key) {
+    /* values are scored for `player_color`, so games played by either colour
+       can share the tables without reading each other's entries */
+    key.clear();
+    board.write_string(key);
+    key += (player_color ? 'W' : 'B');
+}
+
+void clear_tables() {
+    max_table.clear();
+    min_table.clear();
+    last_placement_table.clear();
+    endgame_table.clear();
+    /* emptied in place, so the buffers stay warm for the next search */
+    SearchMemory &memory = search_memory;
+    memory.killers.clear();
+    fill(&memory.history[0][0], &memory.history[0][0] + 2 * HISTORY_SIZE, 0);
+    memory.root_key.clear();
+    memory.root_order.clear();
+    memory.pv.clear();
+    memory.pv_key.clear();
+}
+
+/* drops entries no search has touched for TABLE_AGE generations, and
+   everything once that is not enough */
+void age_tables() {
+    for(tranposition_table *table : {&max_table, &min_table}) {
+        for(auto entry = table->begin(); entry != table->end(); ) {
+            if((uint16_t)(search_generation - entry->second.generation) > TABLE_AGE) entry = table->erase(entry);
+            else ++entry;
+        }
+    }
+    if(max_table.size() + min_table.size() > table_limit) {
+        max_table.clear();
+        min_table.clear();
+    }
+    last_placement_table.clear();
+    endgame_table.clear();
+}
+
+const int PROBE_SAMPLE = 64;
+
+/* builds the key of the node into `key` and looks it up */
+TableEntry *probe_entry(tranposition_table &table, const Board &board, const bool player_color, TableKey &key) {
+    /* reading the clock costs about as much as a cached probe, so only a
+       sample of the probes is timed, each from the key to the lookup */
+    if((++search_stats.tt_probes % PROBE_SAMPLE) != 0) {
+        table_key(board, player_color, key);
+        const auto entry = table.find(key);
+        return (entry == table.end()) ? NULL : &entry->second;
+    }
+    const auto start = chrono::steady_clock::now();
+    table_key(board, player_color, key);
+    const auto entry = table.find(key);
+    search_stats.tt_probe_ns += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    ++search_stats.tt_probe_samples;
+    return (entry == table.end()) ? NULL : &entry->second;
+}
+
+/* whether `memo` is deep enough, and its bound tight enough, to end the node */
+bool use_entry(TableEntry &memo, const int alpha, const int beta, const int cutoff) {
+    if(memo.depth < cutoff) return false;
+    if(memo.bound == BOUND_LOWER and memo.result.second < beta) return false;
+    if(memo.bound == BOUND_UPPER and memo.result.second > alpha) return false;
+    memo.generation = search_generation;
+    ++search_stats.tt_hits;
+    return true;
+}
+
+void store_entry(tranposition_table &table, const TableKey &key, const pair<Move, int> &result,
+                 const int cutoff, const TableBound bound) {
+    /* a search cut short by its budget leaves nothing reliable to keep */
+    if(search_budget.stopped) return;
+    auto entry = table.find(key);
+    if(entry == table.end()) entry = table.insert(make_pair(key, TableEntry())).first;
+    /* a shallow iteration of the next move must not undo the deep work of the last */
+    else if(entry->second.depth > cutoff) return;
+    TableEntry &memo = entry->second;
+    memo.result = result;
+    memo.depth = cutoff;
+    memo.bound = bound;
+    memo.generation = search_generation;
+}
+
+int history_slot(const Move &move) {
+    return hash<string>()(move) & (HISTORY_SIZE - 1);
+}
+
+void record_cutoff(const Move &move, const int ply, const int cutoff, const bool white) {
+    auto &killers = search_memory.killers;
+    if(ply >= (int)killers.size()) killers.resize(ply + 1);
+    if(killers[ply].first != move) {
+        killers[ply].second = killers[ply].first;
+        killers[ply].first = move;
+    }
+    int &score = search_memory.history[white][history_slot(move)];
+    score = min(score + cutoff * cutoff, HISTORY_MAX);
+}
+
+/* by value, best first, ties in the order the moves came in */
+bool better(const OrderedMove &a, const OrderedMove &b) {
+    return a.value > b.value or (a.value == b.value and a.index < b.index);
+}
+
+/* sorts `moves` by history, so that moves the ordering pass ties keep it */
+void history_first(Moves &moves, const bool white, vector<OrderedMove> &scratch) {
+    for(auto &move : moves) {
+        scratch.push_back(OrderedMove{search_memory.history[white][history_slot(move)], (int)scratch.size(), Move()});
+        scratch.back().move.swap(move);
+    }
+    /* std::sort works in place, where stable_sort would take a buffer from the heap */
+    sort(scratch.begin(), scratch.end(), better);
+    for(size_t i = 0; i < moves.size(); ++i) moves[i].swap(scratch[i].move);
+    scratch.clear();
+}
+
+bool contains(const Moves &moves, const Move &move) {
+    return find(moves.begin(), moves.end(), move) != moves.end();
+}
+
+/* the table move, then the killers of `ply`, each only if it is legal here */
+void pick_known(const Moves &moves, const Move &table_move, const int ply, Moves &known) {
+    if(not table_move.empty() and contains(moves, table_move)) known.push_back(table_move);
+    const auto &killers = search_memory.killers;
+    if(ply >= (int)killers.size()) return;
+    for(const Move &killer : {killers[ply].first, killers[ply].second}) {
+        if(not killer.empty() and not contains(known, killer) and contains(moves, killer)) known.push_back(killer);
+    }
+}
+
+/* the root moves of the last search, best first, for the next search of the same root */
+void keep_root_order(const Move &best, const Moves &known, const vector<OrderedMove> &order) {
+    Moves &root_order = search_memory.root_order;
+    root_order.clear();
+    root_order.push_back(best);
+    for(const auto &move : known) if(move != best) root_order.push_back(move);
+    for(const auto &ordered : order) if(ordered.move != best) root_order.push_back(ordered.move);
+}
+
+bool same_key(const string &kept, const TableKey &key) {
+    return kept.size() == key.size() and kept.compare(0, kept.size(), key.data(), key.size()) == 0;
+}
+
+/* follows the table moves from the root for at most `cutoff` plies */
+void keep_pv(Board &board, const int cutoff, const bool player_color) {
+    Moves &pv = search_memory.pv;
+    pv.clear();
+    search_memory.pv_key.clear();
+    static thread_local TableKey key;
+    vector<bool> crushes;
+    for(int ply = 0; ply < cutoff; ++ply) {
+        const bool mover = (ply % 2 == 0) ? player_color : not player_color;
+        tranposition_table &table = (ply % 2 == 0) ? max_table : min_table;
+        table_key(board, player_color, key);
+        if(ply == 2) search_memory.pv_key.assign(key.data(), key.size());
+        const auto entry = table.find(key);
+        if(entry == table.end() or entry->second.result.first.empty()) break;
+        const Move &move = entry->second.result.first;
+        if(board.game_over() or not board.playable(move, mover)) break;
+        pv.push_back(move);
+        crushes.push_back(board.perform_move(move, mover));
+    }
+    for(int ply = (int)pv.size() - 1; ply >= 0; --ply)
+        board.undo_move(pv[ply], (ply % 2 == 0) ? player_color : not player_color, crushes[ply]);
+}
+
+void limit_tables(const size_t max_entries) {
+    table_limit = max_entries;
+}
+
+bool game_over_value(const Board &board, const bool player_color, const bool mover, int &value) {
+    if(board.player_road_win(mover)) value = (mover == player_color) ? INT_MAX : INT_MIN;
+    else if(board.player_road_win(not mover)) value = (mover == player_color) ? INT_MIN : INT_MAX;
+    else if(not board.game_flat_win()) return false;
+    else {
+        /* player_flat_win holds for both sides on a draw */
+        const bool player_win = board.player_flat_win(player_color);
+        const bool other_win = board.player_flat_win(not player_color);
+        value = (player_win and other_win) ? 0 : (player_win ? INT_MAX : INT_MIN);
+    }
+    return true;
+}
+
+int last_placement_value(Board &board, const bool player_color, const bool to_move) {
+    ++search_stats.last_placement_nodes;
+    PlyFrame frame;
+    TableKey &hash_string = frame.ply.key;
+    table_key(board, player_color, hash_string);
+    hash_string += (to_move ? 'w' : 'b');
+    const auto memo = last_placement_table.find(hash_string);
+    if(memo != last_placement_table.end()) return memo->second;
+    const int win = (to_move == player_color) ? INT_MAX : INT_MIN;
+    int value = board.evaluate(player_color);
+    Moves &moves = frame.ply.moves;
+    generate_placement_moves(board, moves, to_move);
+    /* filling the last square is what ends the game, so flat placements go first */
+    move_to_front(moves, [](const Move &move) { return move[0] == 'F'; });
+    for(const auto &move : moves) {
+        board.perform_move(move, to_move);
+        int outcome;
+        const bool over = game_over_value(board, player_color, to_move, outcome);
+        board.undo_move(move, to_move, false);
+        if(over and outcome == win) {
+            value = win;
+            break;
+        }
+    }
+    last_placement_table[hash_string] = value;
+    return value;
+}
+
+int leaf_value(Board &board, const bool player_color, const bool to_move) {
+    if(not board.last_placement_near()) return board.evaluate(player_color);
+    return last_placement_value(board, player_color, to_move);
+}
+
+bool out_of_budget();
+
+/* nodes the current solve may still visit, 0 once it ran out */
+thread_local long long endgame_nodes_left = 0;
+
+Outcome solve_node(Board &board, const bool to_move, const int plies, Move *best) {
+    int over;
+    if(game_over_value(board, to_move, not to_move, over))
+        return (over == 0) ? OUTCOME_DRAW : (over > 0 ? OUTCOME_WIN : OUTCOME_LOSS);
+    if(plies == 0) return OUTCOME_UNKNOWN;
+    if(endgame_nodes_left <= 0 or out_of_budget()) {
+        endgame_nodes_left = 0;
+        return OUTCOME_UNKNOWN;
+    }
+    --endgame_nodes_left;
+    ++search_stats.endgame_nodes;
+    PlyFrame frame;
+    TableKey &key = frame.ply.key;
+    table_key(board, to_move, key);
+    /* the root wants a move, which the table does not keep */
+    if(best == NULL) {
+        const auto memo = endgame_table.find(key);
+        if(memo != endgame_table.end()) {
+            if(memo->second.outcome != OUTCOME_UNKNOWN) return (Outcome)memo->second.outcome;
+            if(memo->second.plies >= plies) return OUTCOME_UNKNOWN;
+        }
+    }
+    Outcome result = OUTCOME_LOSS;
+    find_winning_moves(board, to_move, frame.ply.wins);
+    if(not frame.ply.wins.empty()) {
+        result = OUTCOME_WIN;
+        if(best != NULL) *best = frame.ply.wins.front();
+    }
+    else if(plies == 1 and not board.last_placement_near()) {
+        /* no road and no placement ends the game now, and a spread that
+           leaves it running is past the horizon */
+        result = OUTCOME_UNKNOWN;
+    }
+    else {
+        Moves &moves = frame.ply.moves;
+        generate_moves(board, moves, to_move);
+        move_to_front(moves, [](const Move &move) { return move[0] == 'F' or move[0] == 'S' or move[0] == 'C'; });
+        move_to_front(moves, [](const Move &move) { return move[0] == 'F'; });
+        bool unknown = false;
+        for(const auto &move : moves) {
+            const bool did_crush = board.perform_move(move, to_move);
+            const Outcome reply = solve_node(board, not to_move, plies - 1, NULL);
+            board.undo_move(move, to_move, did_crush);
+            if(reply == OUTCOME_UNKNOWN) {
+                unknown = true;
+                continue;
+            }
+            const Outcome outcome = (Outcome)-reply;
+            if(outcome > result or (best != NULL and best->empty())) {
+                result = max(result, outcome);
+                if(best != NULL) *best = move;
+            }
+            if(result == OUTCOME_WIN) break;
+        }
+        /* a loss or a draw is only proven once every reply is */
+        if(unknown and result != OUTCOME_WIN) result = OUTCOME_UNKNOWN;
+    }
+    /* an unknown cut short by the node limit says nothing about its horizon */
+    if(result != OUTCOME_UNKNOWN or endgame_nodes_left > 0)
+        endgame_table[key] = EndgameEntry{(int8_t)result, (int8_t)plies};
+    return result;
+}
+
+Outcome solve_endgame(Board &board, const bool to_move, const int plies, Move &best) {
+    /* short horizons first, a quick win needs no deeper proof */
+    endgame_nodes_left = ENDGAME_NODES;
+    for(int horizon = 1; horizon <= plies and endgame_nodes_left > 0; ++horizon) {
+        best.clear();
+        const Outcome outcome = solve_node(board, to_move, horizon, &best);
+        if(outcome != OUTCOME_UNKNOWN) return outcome;
+    }
+    return OUTCOME_UNKNOWN;
+}
+
+void start_budget(const long long max_nodes, const int max_millis) {
+    search_budget = SearchBudget();
+    search_budget.max_nodes = max_nodes;
+    search_budget.timed = (max_millis > 0);
+    search_budget.deadline = chrono::steady_clock::now() + chrono::milliseconds(max_millis);
+}
+
+bool out_of_budget() {
+    if(search_budget.stopped) return true;
+    ++search_budget.nodes;
+    if(search_budget.max_nodes > 0 and search_budget.nodes > search_budget.max_nodes)
+        search_budget.stopped = true;
+    /* the clock is only read every few nodes */
+    if(search_budget.timed and (search_budget.nodes & 1023) == 0
+        and chrono::steady_clock::now() > search_budget.deadline)
+        search_budget.stopped = true;
+    return search_budget.stopped;
+}
+
+const pair<Move, int> max_node(Board &board, int alpha, int beta, const int cutoff, const bool player_color);
+const pair<Move, int> min_node(Board &board, int alpha, int beta, const int cutoff, const bool player_color);
+
+typedef const pair<Move, int> (*NodeSearch)(Board &, int, int, const int, const bool);
+
+/* how many ordering passes enclose the node being searched */
+thread_local int ordering_passes = 0;
+
+const pair<Move, int> traced_node(NodeSearch search, const bool is_max, Board &board, int alpha, int beta, const int cutoff, const bool player_color) {
+    TraceRecord record;
+    static thread_local TableKey key;
+    table_key(board, player_color, key);
+    record.key = TableKeyHash()(key);
+    record.alpha = alpha;
+    record.beta = beta;
+    record.depth = max(-128, min(127, cutoff));
+    record.ply = min(ply_top, 255);
+    node_note = NodeNote();
+    const auto result = search(board, alpha, beta, cutoff, player_color);
+    record.value = result.second;
+    record.move_index = node_note.move_index;
+    record.flags = node_note.flags | (is_max ? TRACE_MAX : 0) | (ordering_passes ? TRACE_ORDERING : 0);
+    trace_node(record);
+    return result;
+}
+
+const pair<Move, int> max_value(Board &board, int alpha, int beta, const int cutoff, const bool player_color) {
+    if(trace_header == NULL) return max_node(board, alpha, beta, cutoff, player_color);
+    return traced_node(max_node, true, board, alpha, beta, cutoff, player_color);
+}
+
+const pair<Move, int> min_value(Board &board, int alpha, int beta, const int cutoff, const bool player_color) {
+    if(trace_header == NULL) return min_node(board, alpha, beta, cutoff, player_color);
+    return traced_node(min_node, false, board, alpha, beta, cutoff, player_color);
+}
+
+const pair<Move, int> alpha_beta_search(Board &board, const int cutoff, const bool player_color) {
+    search_stats = SearchStats();
+    ply_top = 0;
+    if(max_table.size() + min_table.size() > table_limit) age_tables();
+    static thread_local TableKey key;
+    table_key(board, player_color, key);
+    SearchMemory &memory = search_memory;
+    at_root_key = same_key(memory.root_key, key);
+    if(at_root_key) root_hint = memory.pv.empty() ? Move() : memory.pv[0];
+    else {
+        /* a new root is usually two plies on, our move and the reply */
+        memory.killers.erase(memory.killers.begin(), memory.killers.begin() + min((size_t)2, memory.killers.size()));
+        for(auto &side : memory.history) for(auto &score : side) score /= 2;
+        memory.root_order.clear();
+        root_hint = (memory.pv.size() > 2 and same_key(memory.pv_key, key)) ? memory.pv[2] : Move();
+        memory.pv.clear();
+        memory.root_key.assign(key.data(), key.size());
+        at_root_key = true;
+        /* the deeper iterations of one move share a generation */
+        ++search_generation;
+        /* near the end a proven win or draw beats any heuristic search */
+        memory.solution.clear();
+        Move best;
+        const Outcome outcome = board.endgame_near() ? solve_endgame(board, player_color, ENDGAME_PLIES, best)
+                                                     : OUTCOME_UNKNOWN;
+        if(outcome == OUTCOME_WIN or outcome == OUTCOME_DRAW) {
+            memory.solution = best;
+            memory.solution_value = (outcome == OUTCOME_WIN) ? INT_MAX : 0;
+        }
+    }
+    if(at_root_key and not memory.solution.empty()) {
+        memory.pv.assign(1, memory.solution);
+        return make_pair(memory.solution, memory.solution_value);
+    }
+    board.reserve_stacks();
+    const long long allocations = heap_allocations;
+    const auto result = max_value(board, INT_MIN, INT_MAX, cutoff, player_color);
+    search_stats.allocations = heap_allocations - allocations;
+    if(at_root_key and not search_budget.stopped) keep_pv(board, cutoff, player_color);
+    return result;
+}
+
+const pair<Move, int> deepening_search(Board &board, const int cutoff, const bool player_color) {
+    pair<Move, int> result;
+    for(int depth = 1; depth <= cutoff; ++depth) result = alpha_beta_search(board, depth, player_color);
+    return result;
+}
+
+
+const pair<Move, int> max_node(Board &board, int alpha, int beta, const int cutoff, const bool player_color) {
+    ++search_stats.nodes;
+    if(out_of_budget()) return make_pair("", board.evaluate(player_color));
+    PlyFrame frame;
+    const int ply = ply_top - 1;
+    TableKey &hash_string = frame.ply.key;
+    /* has the other player's move ended the game ? */
+    int over;
+    if(game_over_value(board, player_color, not player_color, over)) {
+        node_note.flags = TRACE_TERMINAL;
+        return make_pair("", over);
+    }
+    /* memoized in the hash table */
+    Move table_move;
+    uint8_t shallow = 0;
+    if(TableEntry *memo = probe_entry(max_table, board, player_color, hash_string)) {
+        if(use_entry(*memo, alpha, beta, cutoff)) {
+            node_note.flags = TRACE_TT_HIT;
+            return memo->result;
+        }
+        table_move = memo->result.first;
+        shallow = TRACE_TT_SHALLOW;
+    }
+    if(ply == 0 and table_move.empty()) table_move = root_hint;
+    if(cutoff <= 0) {
+        node_note.flags = shallow | TRACE_LEAF;
+        return make_pair("", leaf_value(board, player_color, player_color));
+    }
+    /* a road on the next move ends the node before any move is generated */
+    find_winning_moves(board, player_color, frame.ply.wins);
+    if(not frame.ply.wins.empty()) {
+        node_note.flags = shallow | TRACE_WIN;
+        return make_pair(frame.ply.wins.front(), INT_MAX);
+    }
+
+    /* iterative deepening code */
+    const int alpha_start = alpha;
+    int value = INT_MIN;
+    Move optimal_move;
+    Moves &moves = frame.ply.moves;
+    Moves &known = frame.ply.known;
+    vector<OrderedMove> &order = frame.ply.order;
+    generate_moves(board, moves, player_color);
+    history_first(moves, player_color, order);
+    threats_first(board, moves);
+    pick_known(moves, table_move, ply, known);
+    int index = 0, best_index = -1;
+    /* searches `move` in the window, true when the node is cut off */
+    const auto try_move = [&](const Move &move) {
+        const bool did_crush = board.perform_move(move, player_color);
+        int move_min_value = min_value(board, alpha, beta, cutoff-1, player_color).second;
+        if(value < move_min_value or optimal_move.empty()) {
+          value = move_min_value;
+          optimal_move = move;
+          best_index = index;
+        }
+        board.undo_move(move, player_color, did_crush);
+        ++index;
+        if(value >= beta) return true;
+        alpha = max(alpha, value);
+        return false;
+    };
+    /* the table move and killers often cut off before the rest are ordered */
+    bool cut = false;
+    for(const auto &move : known) if((cut = try_move(move))) break;
+    if(cut) ++search_stats.known_cutoffs;
+    else if(ply == 0 and at_root_key and not search_memory.root_order.empty()) {
+        /* the root was searched before, its last order beats a shallow pass */
+        for(const auto &move : search_memory.root_order) if(not contains(known, move)) order.push_back(OrderedMove{0, (int)order.size(), move});
+    }
+    else {
+        ++ordering_passes;
+        for(const auto &move : moves) {
+            if(contains(known, move)) continue;
+            const bool did_crush = board.perform_move(move, player_color);
+            const int value = min_value(board, alpha, beta, cutoff-3, player_color).second;
+            board.undo_move(move, player_color, did_crush);
+            order.push_back(OrderedMove{value, (int)order.size(), move});
+        }
+        --ordering_passes;
+        /* sorts them according to order, ties keep the threats first */
+        sort(order.begin(), order.end(), better);
+    }
+    /* main alpha beta code */
+    if(not cut) for(const auto &ordered : order) if((cut = try_move(ordered.move))) break;
+    node_note.move_index = best_index;
+    node_note.flags = shallow | (cut ? TRACE_CUTOFF : 0);
+    pair<Move, int> move_pair = make_pair(optimal_move, value);
+    if(cut) record_cutoff(optimal_move, ply, cutoff, player_color);
+    else if(ply == 0 and at_root_key and not search_budget.stopped) keep_root_order(optimal_move, known, order);
+    store_entry(max_table, hash_string, move_pair, cutoff,
+                cut ? BOUND_LOWER : (value <= alpha_start ? BOUND_UPPER : BOUND_EXACT));
+    return move_pair;
+}
+
+const pair<Move, int> min_node(Board &board, int alpha, int beta, const int cutoff, const bool player_color) {
+    ++search_stats.nodes;
+    if(out_of_budget()) return make_pair("", board.evaluate(player_color));
+    PlyFrame frame;
+    const int ply = ply_top - 1;
+    TableKey &hash_string = frame.ply.key;
+    /* has our move ended the game */
+    int over;
+    if(game_over_value(board, player_color, player_color, over)) {
+        node_note.flags = TRACE_TERMINAL;
+        return make_pair("", over);
+    }
+    /* memoized in the hash table */
+    Move table_move;
+    uint8_t shallow = 0;
+    if(TableEntry *memo = probe_entry(min_table, board, player_color, hash_string)) {
+        if(use_entry(*memo, alpha, beta, cutoff)) {
+            node_note.flags = TRACE_TT_HIT;
+            return memo->result;
+        }
+        table_move = memo->result.first;
+        shallow = TRACE_TT_SHALLOW;
+    }
+    if(cutoff <= 0) {
+        node_note.flags = shallow | TRACE_LEAF;
+        return make_pair("", leaf_value(board, player_color, not player_color));
+    }
+    find_winning_moves(board, not player_color, frame.ply.wins);
+    if(not frame.ply.wins.empty()) {
+        node_note.flags = shallow | TRACE_WIN;
+        return make_pair(frame.ply.wins.front(), INT_MIN);
+    }
+    /* iterative deepening code*/
+    const int beta_start = beta;
+    int value = INT_MAX;
+    Move optimal_move;
+    Moves &moves = frame.ply.moves;
+    Moves &known = frame.ply.known;
+    vector<OrderedMove> &order = frame.ply.order;
+    generate_moves(board, moves, not player_color);
+    history_first(moves, not player_color, order);
+    threats_first(board, moves);
+    pick_known(moves, table_move, ply, known);
+    int index = 0, best_index = -1;
+    const auto try_move = [&](const Move &move) {
+        const bool did_crush = board.perform_move(move, not player_color);
+        int move_max_value = max_value(board, alpha, beta, cutoff-1, player_color).second;
+        if(value > move_max_value or optimal_move.empty()) {
+          value = move_max_value;
+          optimal_move = move;
+          best_index = index;
+        }
+        board.undo_move(move, not player_color, did_crush);
+        ++index;
+        if(value <= alpha) return true;
+        beta = min(beta, value);
+        return false;
+    };
+    bool cut = false;
+    for(const auto &move : known) if((cut = try_move(move))) break;
+    if(cut) ++search_stats.known_cutoffs;
+    else {
+        ++ordering_passes;
+        for(const auto &move : moves) {
+            if(contains(known, move)) continue;
+            const bool did_crush = board.perform_move(move, not player_color);
+            const int value = max_value(board, alpha, beta, cutoff-3, player_color).second;
+            board.undo_move(move, not player_color, did_crush);
+            order.push_back(OrderedMove{value, (int)order.size(), move});
+        }
+        --ordering_passes;
+        sort(order.begin(), order.end(), [](const OrderedMove &a, const OrderedMove &b) {
+            return a.value < b.value or (a.value == b.value and a.index < b.index);
+        });
+    }
+    /* main alpha beta */
+    if(not cut) for(const auto &ordered : order) if((cut = try_move(ordered.move))) break;
+    node_note.move_index = best_index;
+    node_note.flags = shallow | (cut ? TRACE_CUTOFF : 0);
+    // cerr << "MIN choice = " << optimal_move << " , " << value << "\n";
+    pair<Move, int> move_pair = make_pair(optimal_move, value);
+    if(cut) record_cutoff(optimal_move, ply, cutoff, not player_color);
+    store_entry(min_table, hash_string, move_pair, cutoff,
+                cut ? BOUND_UPPER : (value >= beta_start ? BOUND_LOWER : BOUND_EXACT));
+    return move_pair;
+}
@@ -0,0 +1,185 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "board.h"
+#include "table_memory.h"
+#include <unordered_map>
+#include <cstdint>
+#include <chrono>
+using namespace std;
+
+/* how a stored value relates to the true value of the position */
+enum TableBound { BOUND_EXACT, BOUND_LOWER, BOUND_UPPER };
+
+struct TableEntry {
+    pair<Move, int> result;
+    int depth;
+    uint8_t bound;
+    /* root whose search last stored or used the entry, see search_generation */
+    uint16_t generation;
+};
+
+typedef unordered_map<TableKey, TableEntry, TableKeyHash, equal_to<TableKey>,
+                      TableAllocator<pair<const TableKey, TableEntry> > > tranposition_table;
+extern thread_local tranposition_table max_table;
+extern thread_local tranposition_table min_table;
+/* bumped by every search of a new root, once per move; entries unused for
+   TABLE_AGE moves are the first to go once the tables outgrow their limit */
+extern thread_local uint16_t search_generation;
+const int TABLE_AGE = 8;
+
+/* leaf values from last_placement_value, keyed like the tables plus the side to move */
+typedef unordered_map<TableKey, int, TableKeyHash, equal_to<TableKey>,
+                      TableAllocator<pair<const TableKey, int> > > placement_table;
+extern thread_local placement_table last_placement_table;
+
+/* what the endgame solver proved about a position, for the side to move */
+enum Outcome { OUTCOME_LOSS = -1, OUTCOME_DRAW = 0, OUTCOME_WIN = 1, OUTCOME_UNKNOWN = 2 };
+/* a proven outcome, or OUTCOME_UNKNOWN with the plies it was tried to */
+struct EndgameEntry {
+    int8_t outcome;
+    int8_t plies;
+};
+/* solver results, keyed like the tables with the side to move as the player */
+typedef unordered_map<TableKey, EndgameEntry, TableKeyHash, equal_to<TableKey>,
+                      TableAllocator<pair<const TableKey, EndgameEntry> > > endgame_table_type;
+extern thread_local endgame_table_type endgame_table;
+/* how far and for how many nodes a root is solved */
+const int ENDGAME_PLIES = 5;
+const long long ENDGAME_NODES = 20000;
+
+/* a move and its ordering value, `index` breaks ties in generation order */
+struct OrderedMove {
+    int value;
+    int index;
+    Move move;
+};
+
+/* per-ply scratch data of the search, owned by the ply arena */
+struct Ply {
+    Moves moves;
+    vector<OrderedMove> order;
+    Moves wins;
+    /* table move and killers, searched before the ordering pass */
+    Moves known;
+    /* table key of the node, built in place so that it keeps its buffer */
+    TableKey key;
+};
+
+const int HISTORY_SIZE = 4096;
+
+/*
+ * Move ordering the searches of one game learn and keep across the
+ * opponent's move: two killers per ply, cutoff counts per side and move,
+ * the last root with the order its moves ended up in, and the principal
+ * variation found from it. A thread that plays several games swaps each
+ * game's memory in around its searches.
+ */
+struct SearchMemory {
+    vector<pair<Move, Move> > killers;
+    int history[2][HISTORY_SIZE] = {};
+    /* a plain string, so that a memory may move to another thread */
+    string root_key;
+    Moves root_order;
+    Moves pv;
+    /* key of the position two plies down `pv`, where our next search is likely */
+    string pv_key;
+    /* the move solve_endgame proved best at the root, and its value */
+    Move solution;
+    int solution_value = 0;
+};
+extern thread_local SearchMemory search_memory;
+
+/* counters of the last call to alpha_beta_search */
+struct SearchStats {
+    long long nodes = 0;
+    /* heap allocations made by the search, 0 once the buffers of this
+       thread have grown to a position as wide, even after clear_tables */
+    long long allocations = 0;
+    long long last_placement_nodes = 0;
+    /* nodes of solve_endgame at the root */
+    long long endgame_nodes = 0;
+    /* table lookups, and those deep enough to end the node */
+    long long tt_probes = 0;
+    long long tt_hits = 0;
+    /* probes timed, one in PROBE_SAMPLE, and their total time from
+       building the key to the end of the lookup */
+    long long tt_probe_samples = 0;
+    long long tt_probe_ns = 0;
+    /* nodes cut off by a table move or killer, which skip their ordering pass */
+    long long known_cutoffs = 0;
+};
+extern thread_local SearchStats search_stats;
+
+/* node and time budget shared by every search until the next start_budget */
+struct SearchBudget {
+    long long max_nodes = 0;
+    long long nodes = 0;
+    bool timed = false;
+    chrono::steady_clock::time_point deadline;
+    /* set once the budget ran out, the search then unwinds on evaluations */
+    bool stopped = false;
+};
+extern thread_local SearchBudget search_budget;
+
+/* 0 leaves that part of the budget unlimited, which is the default */
+void start_budget(const long long max_nodes, const int max_millis);
+
+void generate_moves(const Board &board, Moves &moves, const bool white);
+/*
+ * Appends to `wins` every move that gives `white` a road at once: placements
+ * into the gaps of the threat map and spreads whose drops bridge a gap. It
+ * reads the board's bitboards and never performs a move.
+ */
+void find_winning_moves(const Board &board, const bool white, Moves &wins);
+/* moves placements onto either player's road threats to the front */
+void threats_first(const Board &board, Moves &moves);
+
+/* key of `board` in the tables when searched on behalf of `player_color` */
+void table_key(const Board &board, const bool player_color, TableKey &key);
+/* forgets the tables and everything else kept from earlier searches */
+void clear_tables();
+/* flush the tables before a search once they hold more than `max_entries` */
+void limit_tables(const size_t max_entries);
+
+/*
+ * Whether the game is over with `mover` having just moved, and then its
+ * value for `player_color` in `value`: INT_MAX, INT_MIN, or 0 for a draw.
+ * A road of the mover beats one it made for the other side. Every finished
+ * game the search or the solver meets is scored here.
+ */
+bool game_over_value(const Board &board, const bool player_color, const bool mover, int &value);
+
+/*
+ * Leaf value of a position where one placement may end the game, with
+ * `to_move` on move, scored for `player_color`: a win when `to_move` has a
+ * placement that wins at once, the heuristic evaluation otherwise. It is a
+ * cheap check at the leaves; exact results come from solve_endgame.
+ */
+int last_placement_value(Board &board, const bool player_color, const bool to_move);
+
+/*
+ * Exact value of the game for `to_move`, looking `plies` plies ahead at
+ * every legal move: a win if some line forces a finished game it wins, a
+ * loss or a draw once every line is finished and scored, OUTCOME_UNKNOWN
+ * when some line runs past the horizon or ENDGAME_NODES run out. The move
+ * that gets a known outcome is left in `best`. Placements are tried first,
+ * flats before the rest, since filling the board is what ends these games.
+ * Every search of a new root with endgame_near() solves it first, and
+ * plays a proven win or draw at once.
+ */
+Outcome solve_endgame(Board &board, const bool to_move, const int plies, Move &best);
+
+/*
+ * A search of a new root moves the killers two plies on and halves the
+ * history; when the root is two plies down the last principal variation,
+ * the move the variation expected there is tried first. Every finished
+ * search leaves its principal variation in search_memory.pv.
+ */
+const pair<Move, int> alpha_beta_search(Board &board, const int cutoff, const bool player_color);
+/* searches to depth 1, 2, ... `cutoff`, each depth ordered by what the ones before learnt */
+const pair<Move, int> deepening_search(Board &board, const int cutoff, const bool player_color);
+const pair<Move, int> max_value(Board &board, int alpha, int beta, const int cutoff, const bool player_color);
+const pair<Move, int> min_value(Board &board, int alpha, int beta, const int cutoff, const bool player_color);
+
+#endif
@@ -0,0 +1,171 @@
+#include "server.h"
+#include "search.h"
+#include <iostream>
+#include <sstream>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+using namespace std;
+
+/* the opening book is shared by every game and never written to */
+const Move OPENING_MOVE = "Fa1";
+const Move OPENING_REPLY = "Fe1";
+
+/* same depth schedule as the single game loop in main */
+const int DEPTH = 5;
+const int DEPTH_CONSTRAINED = 4;
+const int TIME_CONSTRAINED = 60;
+
+/* wall time since `since`, the clock of the process counts every worker */
+double seconds_since(const chrono::steady_clock::time_point since) {
+    return chrono::duration<double>(chrono::steady_clock::now() - since).count();
+}
+
+/* when the clock of `game` runs out if it is not answered */
+chrono::steady_clock::time_point deadline(const Game &game) {
+    return game.pending.front().second + chrono::milliseconds((long long)(max(game.time_count, 0.0) * 1000));
+}
+
+Move play_search(Game &game, const chrono::steady_clock::time_point received) {
+    /* our clock has been running since the move came in, queued or not */
+    const double time_left = game.time_count - seconds_since(received);
+    const int depth = (time_left < TIME_CONSTRAINED) ? DEPTH_CONSTRAINED : DEPTH;
+    /* the worker's tables serve every game, its move ordering memory only this one */
+    swap(search_memory, game.memory);
+    const auto result = deepening_search(game.board, depth, game.player_color);
+    swap(search_memory, game.memory);
+    game.board.perform_move(result.first, game.player_color);
+    return result.first;
+}
+
+/* our reply to `opponent_move`: a move, or an error that leaves the game as it was */
+string play_reply(Game &game, const Move &opponent_move, const chrono::steady_clock::time_point received) {
+    if(game.board.game_over()) return "error game over";
+    /* the opponent's opening places one of our stones */
+    const bool stone = game.opened ? not game.player_color : game.player_color;
+    if(not game.board.playable(opponent_move, stone)) return "error illegal move";
+    game.board.perform_move(opponent_move, stone);
+    if(game.opened or game.player_color) {
+        game.opened = true;
+        if(game.board.game_over()) return "error game over";
+        return play_search(game, received);
+    }
+    game.opened = true;
+    const Move first_move = (opponent_move == OPENING_MOVE) ? OPENING_REPLY : OPENING_MOVE;
+    game.board.perform_move(first_move, not game.player_color);
+    return first_move;
+}
+
+/* games and the work waiting on them, guarded by `lock` */
+struct Server {
+    mutex lock;
+    condition_variable changed;
+    map<string, Game> games;
+    bool closing = false;
+};
+
+/* the idle game with a pending move whose clock runs out first, or end() */
+map<string, Game>::iterator next_game(Server &server) {
+    auto next = server.games.end();
+    for(auto it = server.games.begin(); it != server.games.end(); ++it) {
+        const Game &game = it->second;
+        if(game.busy or game.pending.empty()) continue;
+        if(next == server.games.end() or deadline(game) < deadline(next->second)) next = it;
+    }
+    return next;
+}
+
+void serve(Server &server, const size_t max_entries) {
+    max_table.reserve(max_entries / 2);
+    min_table.reserve(max_entries / 2);
+    limit_tables(max_entries);
+    unique_lock<mutex> lock(server.lock);
+    while(true) {
+        auto next = server.games.end();
+        server.changed.wait(lock, [&]() {
+            next = next_game(server);
+            return next != server.games.end() or server.closing;
+        });
+        if(next == server.games.end()) return;
+        const string id = next->first;
+        Game &game = next->second;
+        const Move opponent_move = game.pending.front().first;
+        const auto received = game.pending.front().second;
+        game.pending.pop_front();
+        game.busy = true;
+        lock.unlock();
+        const string reply = play_reply(game, opponent_move, received);
+        lock.lock();
+        /* only changed under the lock, where the scheduler reads it */
+        game.time_count -= seconds_since(received);
+        game.busy = false;
+        cout << id << " " << reply << "\n" << flush;
+        if(game.ended) server.games.erase(id);
+        server.changed.notify_all();
+    }
+}
+
+int run_server(const size_t max_entries, const int threads) {
+    Server server;
+    vector<thread> workers;
+    for(int t = 0; t < threads; ++t) workers.emplace_back(serve, ref(server), max_entries / threads);
+    string line;
+    while(getline(cin, line)) {
+        istringstream in(line);
+        string command, id;
+        if(not (in >> command >> id)) continue;
+        lock_guard<mutex> lock(server.lock);
+        auto it = server.games.find(id);
+        if(command == "new") {
+            int player_number, board_size, time_limit;
+            if(not (in >> player_number >> board_size >> time_limit)) {
+                cout << id << " error malformed new\n" << flush;
+                continue;
+            }
+            if(board_size != N) {
+                cout << id << " error unsupported board size\n" << flush;
+                continue;
+            }
+            if(it != server.games.end() and (it->second.busy or it->second.ended)) {
+                cout << id << " error game in progress\n" << flush;
+                continue;
+            }
+            Game &game = server.games[id];
+            game = Game();
+            game.player_color = (player_number == 1);
+            game.time_count = time_limit;
+            if(game.player_color) {
+                /* we open by placing the opponent's stone */
+                game.board.perform_move(OPENING_MOVE, not game.player_color);
+                cout << id << " " << OPENING_MOVE << "\n" << flush;
+            }
+        }
+        else if(command == "move") {
+            Move opponent_move;
+            if(it == server.games.end() or it->second.ended) cout << id << " error unknown game\n" << flush;
+            else if(not (in >> opponent_move)) cout << id << " error malformed move\n" << flush;
+            else {
+                it->second.pending.push_back(make_pair(opponent_move, chrono::steady_clock::now()));
+                server.changed.notify_one();
+            }
+        }
+        else if(command == "end") {
+            if(it == server.games.end()) continue;
+            /* unanswered moves of an ended game are dropped */
+            it->second.pending.clear();
+            if(it->second.busy) it->second.ended = true;
+            else server.games.erase(it);
+        }
+        else {
+            cout << id << " error unknown command\n" << flush;
+        }
+    }
+    {
+        lock_guard<mutex> lock(server.lock);
+        server.closing = true;
+    }
+    server.changed.notify_all();
+    for(auto &worker : workers) worker.join();
+    return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "board.h"
+#include "search.h"
+#include <cstddef>
+#include <chrono>
+#include <deque>
+using namespace std;
+
+/* one game hosted by the server, in the same phases as the stdin protocol */
+struct Game {
+    Board board;
+    bool player_color;
+    /* seconds left on our clock when the last reply went out, written
+       under the server lock */
+    double time_count;
+    /* true once both opening placements are on the board */
+    bool opened = false;
+    /* opponent moves not answered yet, with the time each came in */
+    deque<pair<Move, chrono::steady_clock::time_point> > pending;
+    /* a worker is answering this game, which nobody else may touch */
+    bool busy = false;
+    /* ended while busy, dropped once the worker is done */
+    bool ended = false;
+    /* killers, history and root order of this game, whichever worker searches it */
+    SearchMemory memory;
+};
+
+/*
+ * Line protocol on stdin/stdout, one request per line:
+ *   new <id> <player_number> <board_size> <time_limit>
+ *   move <id> <opponent_move>
+ *   end <id>
+ * Every move of ours is answered as `<id> <move>`, errors as `<id> error <why>`.
+ * Opponent moves are checked before they touch the board, and finished
+ * games are never searched.
+ * Moves are searched by `threads` workers, the game whose clock runs out
+ * first going first. Each worker keeps its own tables, so all of them
+ * together hold at most `max_entries` positions.
+ */
+int run_server(const size_t max_entries, const int threads);
+
+#endif
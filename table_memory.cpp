@@ -0,0 +1,90 @@
+#include "table_memory.h"
+#include <cstdint>
+#include <sys/mman.h>
+using namespace std;
+
+const char *pages_name(const TablePages pages) {
+    switch(pages) {
+        case PAGES_HUGETLB: return "hugetlb";
+        case PAGES_TRANSPARENT: return "transparent";
+        case PAGES_NORMAL: return "normal";
+        default: return "none";
+    }
+}
+
+size_t whole_huge_pages(const size_t bytes) {
+    return (bytes + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+}
+
+void *map_table_memory(const size_t bytes, TablePages &pages) {
+    const size_t length = whole_huge_pages(bytes);
+    const int protection = PROT_READ | PROT_WRITE;
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_HUGETLB
+    /* fails at once when the pool of explicit huge pages is too small */
+    void *huge = mmap(NULL, length, protection, flags | MAP_HUGETLB, -1, 0);
+    if(huge != MAP_FAILED) {
+        pages = PAGES_HUGETLB;
+        return huge;
+    }
+#endif
+    /* one spare huge page of slack lets the mapping start on a 2 MB boundary */
+    void *mapped = mmap(NULL, length + HUGE_PAGE, protection, flags, -1, 0);
+    if(mapped == MAP_FAILED) return NULL;
+    const uintptr_t start = reinterpret_cast<uintptr_t>(mapped);
+    const uintptr_t aligned = (start + HUGE_PAGE - 1) & ~(uintptr_t)(HUGE_PAGE - 1);
+    if(aligned != start) munmap(mapped, aligned - start);
+    munmap(reinterpret_cast<void *>(aligned + length), start + HUGE_PAGE - aligned);
+    void *memory = reinterpret_cast<void *>(aligned);
+    pages = PAGES_NORMAL;
+#ifdef MADV_HUGEPAGE
+    if(madvise(memory, length, MADV_HUGEPAGE) == 0) pages = PAGES_TRANSPARENT;
+#endif
+    return memory;
+}
+
+void unmap_table_memory(void *memory, const size_t bytes) {
+    munmap(memory, whole_huge_pages(bytes));
+}
+
+TableArena::~TableArena() {
+    for(void *chunk : chunks) unmap_table_memory(chunk, CHUNK);
+}
+
+void *TableArena::allocate(const size_t bytes) {
+    if(bytes > LARGE) {
+        void *memory = map_table_memory(bytes, pages);
+        if(memory == NULL) throw bad_alloc();
+        mapped_bytes += whole_huge_pages(bytes);
+        return memory;
+    }
+    const size_t size = (bytes + ALIGN - 1) & ~(ALIGN - 1);
+    void *&free_block = free_blocks[size / ALIGN];
+    if(free_block != NULL) {
+        void *block = free_block;
+        free_block = *static_cast<void **>(block);
+        return block;
+    }
+    if(next == NULL or next + size > end) {
+        void *chunk = map_table_memory(CHUNK, pages);
+        if(chunk == NULL) throw bad_alloc();
+        chunks.push_back(chunk);
+        mapped_bytes += CHUNK;
+        next = static_cast<char *>(chunk);
+        end = next + CHUNK;
+    }
+    void *block = next;
+    next += size;
+    return block;
+}
+
+void TableArena::deallocate(void *block, const size_t bytes) {
+    if(bytes > LARGE) {
+        unmap_table_memory(block, bytes);
+        mapped_bytes -= whole_huge_pages(bytes);
+        return;
+    }
+    const size_t size = (bytes + ALIGN - 1) & ~(ALIGN - 1);
+    *static_cast<void **>(block) = free_blocks[size / ALIGN];
+    free_blocks[size / ALIGN] = block;
+}
@@ -0,0 +1,101 @@
+#ifndef TABLE_MEMORY_H
+#define TABLE_MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+using namespace std;
+
+/* the pages a mapping of table memory ended up on */
+enum TablePages { PAGES_NONE, PAGES_HUGETLB, PAGES_TRANSPARENT, PAGES_NORMAL };
+const char *pages_name(const TablePages pages);
+
+const size_t HUGE_PAGE = (size_t)2 << 20;
+
+/*
+ * Maps `bytes` rounded up to whole huge pages: explicit huge pages when the
+ * host has a pool of them, else a 2 MB aligned mapping advised to become
+ * transparent huge pages, else whatever pages the kernel gives. NULL when
+ * even that fails. Nothing is touched here, so the pages are placed on the
+ * NUMA node of the thread that first writes them.
+ */
+void *map_table_memory(const size_t bytes, TablePages &pages);
+void unmap_table_memory(void *memory, const size_t bytes);
+
+/*
+ * Memory of the tables of one thread. Small blocks (the table nodes) are
+ * carved out of large mapped chunks and recycled through free lists per
+ * size; large ones (bucket arrays) get mappings of their own. Each search
+ * thread owns its arena, so its tables stay on its own node.
+ */
+class TableArena {
+public:
+    ~TableArena();
+    void *allocate(const size_t bytes);
+    void deallocate(void *block, const size_t bytes);
+    /* pages of the latest mapping, PAGES_NONE before the first */
+    TablePages pages = PAGES_NONE;
+    size_t mapped_bytes = 0;
+private:
+    static const size_t ALIGN = 16;
+    static const size_t LARGE = 64 << 10;
+    static const size_t CHUNK = 16 * HUGE_PAGE;
+    vector<void *> chunks;
+    char *next = NULL;
+    char *end = NULL;
+    /* freed small blocks, linked through their first word, by size / ALIGN */
+    void *free_blocks[LARGE / ALIGN + 1] = {};
+};
+
+/* the arena of this thread, which outlives its tables */
+extern thread_local TableArena table_arena;
+
+/* standard allocator over an arena, the storage plug of the tables */
+template <typename T>
+struct TableAllocator {
+    typedef T value_type;
+    TableArena *arena;
+    TableAllocator() : arena(&table_arena) {}
+    explicit TableAllocator(TableArena *arena) : arena(arena) {}
+    template <typename U>
+    TableAllocator(const TableAllocator<U> &other) : arena(other.arena) {}
+    T *allocate(const size_t n) {
+        return static_cast<T *>(arena->allocate(n * sizeof(T)));
+    }
+    void deallocate(T *block, const size_t n) {
+        arena->deallocate(block, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const TableAllocator<T> &a, const TableAllocator<U> &b) { return a.arena == b.arena; }
+template <typename T, typename U>
+bool operator!=(const TableAllocator<T> &a, const TableAllocator<U> &b) { return a.arena != b.arena; }
+
+/* table keys live in the arena too, so storing one never calls the heap;
+   a key must not leave the thread that made it */
+typedef basic_string<char, char_traits<char>, TableAllocator<char> > TableKey;
+
+/* hashes a key eight bytes at a time */
+struct TableKeyHash {
+    size_t operator()(const TableKey &key) const {
+        const char *bytes = key.data();
+        size_t left = key.size();
+        uint64_t hash = left * 0x9e3779b97f4a7c15ull;
+        for(; left >= 8; bytes += 8, left -= 8) {
+            uint64_t word;
+            memcpy(&word, bytes, 8);
+            hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+            hash ^= hash >> 32;
+        }
+        uint64_t word = 0;
+        memcpy(&word, bytes, left);
+        hash = (hash ^ word) * 0xc4ceb9fe1a85ec53ull;
+        return hash ^ (hash >> 29);
+    }
+};
+
+#endif
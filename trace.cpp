@@ -0,0 +1,41 @@
+#include "trace.h"
+#include <iostream>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+using namespace std;
+
+thread_local NodeNote node_note;
+thread_local TraceHeader *trace_header = NULL;
+thread_local size_t trace_bytes = 0;
+
+bool start_trace(const string &path, const uint64_t capacity) {
+    stop_trace();
+    const size_t bytes = sizeof(TraceHeader) + capacity * sizeof(TraceRecord);
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0 or capacity == 0 or ftruncate(fd, bytes) != 0) {
+        cerr << "cannot trace to " << path << "\n";
+        if(fd >= 0) close(fd);
+        return false;
+    }
+    void *mapped = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    /* the mapping keeps the file alive on its own */
+    close(fd);
+    if(mapped == MAP_FAILED) {
+        cerr << "cannot map " << path << "\n";
+        return false;
+    }
+    trace_header = static_cast<TraceHeader *>(mapped);
+    trace_header->magic = TRACE_MAGIC;
+    trace_header->record_size = sizeof(TraceRecord);
+    trace_header->capacity = capacity;
+    trace_header->written = 0;
+    trace_bytes = bytes;
+    return true;
+}
+
+void stop_trace() {
+    if(trace_header == NULL) return;
+    munmap(trace_header, trace_bytes);
+    trace_header = NULL;
+}
@@ -0,0 +1,62 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <string>
+using namespace std;
+
+/* "TKTR", first word of every trace file */
+const uint32_t TRACE_MAGIC = 0x544b5452;
+
+enum TraceFlags {
+    TRACE_MAX = 1,         /* a max node, else a min node */
+    TRACE_CUTOFF = 2,      /* the window closed before every move was tried */
+    TRACE_LEAF = 4,        /* scored by evaluation at the horizon */
+    TRACE_WIN = 8,         /* ended by an immediate road win */
+    TRACE_TT_HIT = 16,     /* answered by the table */
+    TRACE_TT_SHALLOW = 32, /* in the table, but searched too shallow to use */
+    TRACE_ORDERING = 64,   /* below the shallow pass that orders a parent's moves */
+    TRACE_TERMINAL = 128,  /* the game was already over, the table was not probed */
+};
+
+/* one node of the search tree, written as the node returns */
+struct TraceRecord {
+    uint64_t key;          /* hash of the table key */
+    int32_t alpha, beta;   /* window on entry */
+    int32_t value;
+    int16_t move_index;    /* move that cut off or was best, -1 for none */
+    int8_t depth;          /* remaining cutoff */
+    uint8_t ply;           /* distance from the root */
+    uint8_t flags;
+};
+
+/* start of the file, followed by `capacity` records used as a ring */
+struct TraceHeader {
+    uint32_t magic;
+    uint32_t record_size;
+    uint64_t capacity;
+    /* records ever written, the newest is at (written - 1) % capacity */
+    uint64_t written;
+};
+
+/* what the search learnt about the node it is returning from */
+struct NodeNote {
+    int move_index = -1;
+    uint8_t flags = 0;
+};
+extern thread_local NodeNote node_note;
+
+/* header of the mapped trace file of this thread, null when not tracing */
+extern thread_local TraceHeader *trace_header;
+
+/* maps a ring of `capacity` records at `path` for this thread's searches */
+bool start_trace(const string &path, const uint64_t capacity);
+void stop_trace();
+
+inline void trace_node(const TraceRecord &record) {
+    TraceRecord *ring = reinterpret_cast<TraceRecord *>(trace_header + 1);
+    ring[trace_header->written % trace_header->capacity] = record;
+    ++trace_header->written;
+}
+
+#endif
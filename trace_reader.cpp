@@ -0,0 +1,134 @@
+#include "trace.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+using namespace std;
+
+/*
+ * Summarises a trace written by a search run with TAKTICS_TRACE set.
+ *   trace_reader FILE
+ * Reports the shape of the searched tree (nodes and effective branching
+ * factor per ply), how well moves were ordered (cutoffs on the first move)
+ * and how much the transposition tables helped. The nodes of the shallow
+ * ordering passes sit at the same plies as the main search but answer a
+ * different question, so they are counted apart, and nodes where the game
+ * was already over are left out of table rates since they never probe.
+ * Only the records still in the ring are counted when it has wrapped.
+ */
+
+struct Counts {
+    uint64_t nodes = 0, cutoffs = 0, first_cutoffs = 0, leaves = 0, wins = 0;
+    uint64_t terminals = 0, tt_hits = 0, tt_shallow = 0;
+    /* nodes that looked in the table */
+    uint64_t probed() const { return nodes - terminals; }
+};
+
+double percent(const uint64_t part, const uint64_t whole) {
+    return whole ? 100.0 * part / whole : 0.0;
+}
+
+void count_record(const TraceRecord &record, Counts &counts) {
+    ++counts.nodes;
+    if(record.flags & TRACE_LEAF) ++counts.leaves;
+    if(record.flags & TRACE_WIN) ++counts.wins;
+    if(record.flags & TRACE_TERMINAL) ++counts.terminals;
+    if(record.flags & TRACE_TT_HIT) ++counts.tt_hits;
+    if(record.flags & TRACE_TT_SHALLOW) ++counts.tt_shallow;
+    if(record.flags & TRACE_CUTOFF) {
+        ++counts.cutoffs;
+        if(record.move_index == 0) ++counts.first_cutoffs;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if(argc < 2) {
+        cerr << "usage: " << argv[0] << " FILE\n";
+        return 1;
+    }
+    const int fd = open(argv[1], O_RDONLY);
+    struct stat info;
+    if(fd < 0 or fstat(fd, &info) != 0 or (size_t)info.st_size < sizeof(TraceHeader)) {
+        cerr << "cannot read " << argv[1] << "\n";
+        return 1;
+    }
+    void *mapped = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED) {
+        cerr << "cannot map " << argv[1] << "\n";
+        return 1;
+    }
+    const TraceHeader &header = *static_cast<const TraceHeader *>(mapped);
+    if(header.magic != TRACE_MAGIC or header.record_size != sizeof(TraceRecord)
+       or sizeof(TraceHeader) + header.capacity * sizeof(TraceRecord) > (size_t)info.st_size) {
+        cerr << argv[1] << " is not a trace of this build\n";
+        return 1;
+    }
+    const TraceRecord *ring = reinterpret_cast<const TraceRecord *>(&header + 1);
+    const bool wrapped = header.written > header.capacity;
+    const uint64_t kept = wrapped ? header.capacity : header.written;
+
+    Counts total, ordering;
+    map<int, Counts> by_ply, by_depth, ordering_by_ply;
+    uint64_t searches = 0;
+    /* oldest record first, so a wrapped ring is read in the order it was written */
+    for(uint64_t i = header.written - kept; i < header.written; ++i) {
+        const TraceRecord &record = ring[i % header.capacity];
+        if(record.ply == 0) ++searches;
+        if(record.flags & TRACE_ORDERING) {
+            count_record(record, ordering);
+            count_record(record, ordering_by_ply[record.ply]);
+            continue;
+        }
+        count_record(record, total);
+        count_record(record, by_ply[record.ply]);
+        count_record(record, by_depth[record.depth]);
+    }
+
+    cout << fixed << setprecision(1);
+    cout << "records " << kept << " of " << header.written << " written"
+         << (wrapped ? " (ring wrapped, oldest records lost)" : "") << "\n";
+    cout << "searches " << searches << "\n";
+    cout << "main search " << total.nodes << " nodes, ordering passes " << ordering.nodes << " nodes ("
+         << percent(ordering.nodes, total.nodes + ordering.nodes) << "% of all)\n";
+    cout << "\nmain search\n";
+    cout << "cutoffs " << total.cutoffs << ", on the first move " << percent(total.first_cutoffs, total.cutoffs) << "%\n";
+    cout << "table hits " << percent(total.tt_hits, total.probed()) << "%, too shallow "
+         << percent(total.tt_shallow, total.probed()) << "%, misses "
+         << percent(total.probed() - total.tt_hits - total.tt_shallow, total.probed()) << "%\n";
+    cout << "leaves " << total.leaves << ", immediate wins " << total.wins
+         << ", games already over " << total.terminals << "\n";
+    cout << "\nordering passes\n";
+    cout << "table hits " << percent(ordering.tt_hits, ordering.probed()) << "%, too shallow "
+         << percent(ordering.tt_shallow, ordering.probed()) << "%, misses "
+         << percent(ordering.probed() - ordering.tt_hits - ordering.tt_shallow, ordering.probed()) << "%\n";
+
+    /* branching counts main search children only, the ordering nodes are a column of their own */
+    cout << "\nply      nodes  branching  cutoffs  first-cut  table-hits   ordering\n";
+    for(const auto &entry : by_ply) {
+        const Counts &counts = entry.second;
+        cout << setw(3) << entry.first << setw(11) << counts.nodes;
+        const auto next = by_ply.find(entry.first + 1);
+        if(next != by_ply.end()) cout << setw(11) << (double)next->second.nodes / counts.nodes;
+        else cout << setw(11) << "-";
+        const auto shallow = ordering_by_ply.find(entry.first);
+        cout << setw(9) << counts.cutoffs
+             << setw(10) << percent(counts.first_cutoffs, counts.cutoffs) << "%"
+             << setw(11) << percent(counts.tt_hits, counts.probed()) << "%"
+             << setw(11) << (shallow != ordering_by_ply.end() ? shallow->second.nodes : 0) << "\n";
+    }
+
+    cout << "\ndepth    nodes   leaves  table-hits  too-shallow\n";
+    for(auto entry = by_depth.rbegin(); entry != by_depth.rend(); ++entry) {
+        const Counts &counts = entry->second;
+        cout << setw(5) << entry->first << setw(9) << counts.nodes << setw(9) << counts.leaves
+             << setw(11) << percent(counts.tt_hits, counts.probed()) << "%"
+             << setw(12) << percent(counts.tt_shallow, counts.probed()) << "%\n";
+    }
+    munmap(mapped, info.st_size);
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include "utility.h"
 #include <cassert>
 #include <iostream>
+#include <cctype>
 using namespace std;
 
 bool out_of_bounds(const int x, const int y, const int N) {
@@ -57,3 +58,17 @@ bool check_black(const Stones &stone) {
     return (stone == BLACK_FLAT || stone == BLACK_WALL
         || stone == BLACK_CAP || stone == BLACK_CRUSH);
 }
+
+Move ptn_to_move(const string &ptn) {
+    /* PTN leaves out the F of flat placements and the counts of single stones */
+    string s = ptn;
+    while(not s.empty() and string("'!?*\"").find(s.back()) != string::npos) s.pop_back();
+    if(s.size() == 2 and islower(s[0])) return "F" + s;
+    if(s.size() == 3 and (s[0] == 'F' or s[0] == 'S' or s[0] == 'C')) return s;
+    const int i = isdigit(s[0]) ? 1 : 0;
+    if((int)s.size() < i + 3 or not islower(s[i])) return "";
+    if(string("+-<>").find(s[i+2]) == string::npos) return "";
+    const string count = i ? s.substr(0, 1) : "1";
+    const string drops = s.substr(i + 3);
+    return count + s.substr(i, 3) + (drops.empty() ? count : drops);
+}
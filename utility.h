@@ -1,3 +1,6 @@
+#ifndef UTILITY_H
+#define UTILITY_H
+
 #include <string>
 #include <vector>
 #include <algorithm>
@@ -24,6 +27,10 @@ int next_y(const int y, const char dir);
 string make_sqr(const int x, const int y, const int N=5);
 void print_moves(Moves moves);
 pair<int, int> make_xy(const char x, const char y);
+/* our notation of a PTN move, empty if it is not one */
+Move ptn_to_move(const string &ptn);
 
 bool check_white(const Stones &stone);
 bool check_black(const Stones &stone);
+
+#endif